@@ -7,6 +7,59 @@
 #include <exception>
 #include <typeinfo>
 #include <random>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <cstring>
+#include <chrono>
+#include <iterator>
+#include <ranges>
+#include <new>
+#include <shared_mutex>
+#include <climits>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <coroutine>
+#include <queue>
+#include <utility>
+#include <sstream>
+#include <string_view>
+#include <bit>
+#include <fstream>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Vector instruction sets, selected at runtime.
+#if defined( _M_X64 ) || defined( __x86_64__ )
+#define IX_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define IX_TARGET( isa )
+#else
+#define IX_TARGET( isa ) __attribute__(( target( isa ) ))
+#endif
+#endif
 
 using namespace std;
 
@@ -51,6 +104,323 @@ private:
     string m_szMessage;  // Exception description.
 };
 
+// Highest log level compiled in. The messages above it are eliminated at compile time.
+#ifndef IX_LOG_COMPILED_LEVEL
+#define IX_LOG_COMPILED_LEVEL 4
+#endif
+
+// Ring buffer of the log messages of one thread. The thread writes and the log writer reads,
+// so neither needs a lock. Each message is stored with its length and sequence number in front of it.
+class CIXLogRing
+{
+public:
+
+    // Constructor.
+    CIXLogRing()
+        : m_upBuffer( new char[ c_stSize ] ), m_stHead( 0 ), m_stTail( 0 ), m_bOrphaned( false )
+    {
+    }
+
+    // Appends a message. Returns false if there is no room for it at the moment.
+    bool TryWrite( uint64_t uSequence, string_view svMessage )
+    {
+        // Check the room. Only this thread moves the head.
+        uint32_t uLength = static_cast< uint32_t >( std::min( svMessage.size(), c_stSize / 2 ) );
+        size_t stHead = m_stHead.load( memory_order_relaxed );
+        if( c_stSize - ( stHead - m_stTail.load( memory_order_acquire ) ) < c_stHeader + uLength )
+            return false;
+
+        // Copy and publish.
+        Copy( stHead, &uLength, sizeof( uLength ) );  // void
+        Copy( stHead + sizeof( uLength ), &uSequence, sizeof( uSequence ) );  // void
+        Copy( stHead + c_stHeader, svMessage.data(), uLength );  // void
+        m_stHead.store( stHead + c_stHeader + uLength, memory_order_release );
+        return true;
+    }
+
+    // Passes the messages written so far with their sequence numbers to the specified function
+    // and releases their room.
+    template< typename TOutput >
+    void Drain( TOutput output )
+    {
+        // Read up to the head. Only the writer moves the tail.
+        size_t stTail = m_stTail.load( memory_order_relaxed );
+        size_t stHead = m_stHead.load( memory_order_acquire );
+        while( stTail < stHead )
+        {
+            uint32_t uLength = 0;
+            uint64_t uSequence = 0;
+            Read( stTail, &uLength, sizeof( uLength ) );  // void
+            Read( stTail + sizeof( uLength ), &uSequence, sizeof( uSequence ) );  // void
+            m_szMessage.resize( uLength );
+            Read( stTail + c_stHeader, m_szMessage.data(), uLength );  // void
+            output( uSequence, string_view( m_szMessage ) );  // void
+            stTail += c_stHeader + uLength;
+
+        }  // end while
+        m_stTail.store( stTail, memory_order_release );
+    }
+
+    // Marks the ring as left behind by its thread.
+    void SetOrphaned() { m_bOrphaned.store( true ); }
+
+    // Indicates whether the thread has left the ring behind.
+    bool IsOrphaned() const { return m_bOrphaned.load(); }
+
+private:
+
+    // Copies the data into the buffer at the specified position, wrapping around at the end.
+    void Copy( size_t stPosition, const void* pData, size_t stLength )
+    {
+        size_t stOffset = stPosition % c_stSize;
+        size_t stFirst = std::min( stLength, c_stSize - stOffset );
+        memcpy( m_upBuffer.get() + stOffset, pData, stFirst );
+        memcpy( m_upBuffer.get(), static_cast< const char* >( pData ) + stFirst, stLength - stFirst );
+    }
+
+    // Copies the data from the buffer at the specified position, wrapping around at the end.
+    void Read( size_t stPosition, void* pData, size_t stLength ) const
+    {
+        size_t stOffset = stPosition % c_stSize;
+        size_t stFirst = std::min( stLength, c_stSize - stOffset );
+        memcpy( pData, m_upBuffer.get() + stOffset, stFirst );
+        memcpy( static_cast< char* >( pData ) + stFirst, m_upBuffer.get(), stLength - stFirst );
+    }
+
+private:
+    static const size_t c_stSize = 64 * 1024;  // Size of the buffer.
+    static const size_t c_stHeader = sizeof( uint32_t ) + sizeof( uint64_t );  // Size of the length and sequence number.
+    unique_ptr< char[] > m_upBuffer;  // Buffer.
+    alignas( 64 ) atomic< size_t > m_stHead;  // Total bytes written.
+    alignas( 64 ) atomic< size_t > m_stTail;  // Total bytes read.
+    atomic< bool > m_bOrphaned;  // Indicates whether the thread has exited.
+    string m_szMessage;  // Message being read, reused.
+};
+
+// Asynchronous log. The messages are formatted on the calling thread into its own ring buffer,
+// and a background writer moves them to the standard output, so logging never flushes the
+// stream nor waits for it. Each message takes a global sequence number when queued, and the
+// writer merges the rings by it, so the messages keep their order across threads. Use IX_LOG.
+class CIXLog
+{
+public:
+
+    // Log levels, from the most to the least important.
+    enum class Level { Error, Warning, Info, Debug, Trace };
+
+    // Indicates whether the messages of the level are logged.
+    static bool IsEnabled( Level level )
+    {
+        return static_cast< int >( level ) <= s_iLevel.load( memory_order_relaxed );
+    }
+
+    // Sets the level of the messages logged.
+    static void SetLevel( Level level )
+    {
+        s_iLevel.store( static_cast< int >( level ) );
+    }
+
+    // Parses a level name. Returns false if unknown.
+    static bool ParseLevel( const string& szLevel, OUT Level& level )
+    {
+        const char* rgpszLevels[] = { "error", "warning", "info", "debug", "trace" };
+        for( int iLevel = 0; iLevel < static_cast< int >( size( rgpszLevels ) ); iLevel++ )
+        {
+            if( szLevel == rgpszLevels[ iLevel ] )
+            {
+                level = static_cast< Level >( iLevel );
+                return true;
+
+            }  // end if
+
+        }  // end for
+        return false;
+    }
+
+    // Begins formatting a message on the calling thread.
+    static ostringstream& BeginMessage()
+    {
+        // The stream is reused by the thread.
+        thread_local ostringstream oss;
+        oss.str( string() );
+        return oss;
+    }
+
+    // Completes the message and queues it for writing.
+    static void EndMessage( ostringstream& oss )
+    {
+        oss << '\n';
+        Instance().Write( oss.view() );  // void
+    }
+
+    // Writes out the messages queued so far.
+    static void Flush()
+    {
+        // Wait for the messages still being queued by other threads.
+        while( Instance().Drain( false ) )
+            this_thread::yield();  // void
+    }
+
+private:
+
+    // Constructor.
+    CIXLog()
+        : m_uSequence( 0 ), m_uNextSequence( 0 ), m_bStop( false )
+    {
+        // Start the writer.
+        m_thread = thread( &CIXLog::Writer, this );
+    }
+
+    // Destructor.
+    ~CIXLog()
+    {
+        // Stop the writer and write out the rest.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+        Drain( true );  // Return value ignored.
+    }
+
+    // Accesses the log.
+    static CIXLog& Instance()
+    {
+        static CIXLog log;
+        return log;
+    }
+
+    // Queues a message from the calling thread.
+    void Write( string_view svMessage )
+    {
+        // Wait for the writer while the ring is full.
+        CIXLogRing& ring = AccessRing();
+        uint64_t uSequence = m_uSequence.fetch_add( 1 );
+        int iRounds = 0;
+        while( ring.TryWrite( uSequence, svMessage ) == false )
+        {
+            m_cv.notify_all();
+            if( iRounds++ < 64 )
+                this_thread::yield();  // void
+            else
+                this_thread::sleep_for( chrono::microseconds( 50 ) );  // void
+
+        }  // end while
+    }
+
+    // Accesses the ring of the calling thread, creating it on the first use.
+    CIXLogRing& AccessRing()
+    {
+        // The ring outlives the thread until written out.
+        struct Holder
+        {
+            shared_ptr< CIXLogRing > m_shpRing;  // Ring of the thread.
+            ~Holder() { if( m_shpRing ) m_shpRing->SetOrphaned(); }
+        };
+        thread_local Holder holder;
+        if( holder.m_shpRing == nullptr )
+        {
+            holder.m_shpRing = make_shared< CIXLogRing >();
+            lock_guard< mutex > lock( m_mutexRings );
+            m_vecRings.push_back( holder.m_shpRing );
+
+        }  // end if
+        return *holder.m_shpRing;
+    }
+
+    // Writes out the messages of all rings in sequence order. A message is held back while an
+    // earlier one is still being queued, unless all are written out. Returns true if any is held back.
+    bool Drain( bool bAll )
+    {
+        // One reader at a time.
+        lock_guard< mutex > lockDrain( m_mutexDrain );
+        vector< shared_ptr< CIXLogRing > > vecRings;
+        {
+            lock_guard< mutex > lock( m_mutexRings );
+            vecRings = m_vecRings;
+        }
+
+        // Collect the messages, and drop the rings left behind once empty.
+        bool bOrphans = false;
+        for( const shared_ptr< CIXLogRing >& shpRing : vecRings )
+        {
+            bool bOrphaned = shpRing->IsOrphaned();
+            shpRing->Drain( [ this ]( uint64_t uSequence, string_view svMessage ) { m_vecPending.emplace_back( uSequence, svMessage ); } );  // void
+            bOrphans = bOrphans || bOrphaned;
+
+        }  // end for
+        if( bOrphans )
+        {
+            lock_guard< mutex > lock( m_mutexRings );
+            erase_if( m_vecRings, []( const shared_ptr< CIXLogRing >& shpRing ) { return shpRing->IsOrphaned(); } );  // Return value ignored.
+
+        }  // end if
+
+        // Write out the messages up to the first gap in the sequence.
+        sort( m_vecPending.begin(), m_vecPending.end(),
+                []( const pair< uint64_t, string >& left, const pair< uint64_t, string >& right ) { return left.first < right.first; } );
+        size_t stWritten = 0;
+        while( stWritten < m_vecPending.size() && ( bAll || m_vecPending[ stWritten ].first == m_uNextSequence ) )
+        {
+            cout.write( m_vecPending[ stWritten ].second.data(), m_vecPending[ stWritten ].second.size() );  // Return value ignored.
+            m_uNextSequence = m_vecPending[ stWritten ].first + 1;
+            stWritten++;
+
+        }  // end while
+        cout.flush();
+        m_vecPending.erase( m_vecPending.begin(), m_vecPending.begin() + stWritten );  // Return value ignored.
+        return m_vecPending.empty() == false;
+    }
+
+    // Background writer.
+    void Writer()
+    {
+        // Write out periodically and whenever a ring is full.
+        unique_lock< mutex > lock( m_mutex );
+        while( m_bStop == false )
+        {
+            m_cv.wait_for( lock, chrono::milliseconds( 1 ) );
+            lock.unlock();
+            Drain( false );  // Return value ignored.
+            lock.lock();
+
+        }  // end while
+    }
+
+private:
+    static atomic< int > s_iLevel;  // Level of the messages logged.
+    mutex m_mutexRings;  // Guards the rings.
+    vector< shared_ptr< CIXLogRing > > m_vecRings;  // Rings of the threads.
+    atomic< uint64_t > m_uSequence;  // Sequence number of the next message queued.
+    mutex m_mutexDrain;  // Serializes the reading of the rings.
+    vector< pair< uint64_t, string > > m_vecPending;  // Messages read but not yet written out, guarded by the drain mutex.
+    uint64_t m_uNextSequence;  // Sequence number of the next message to write out, guarded by the drain mutex.
+    mutex m_mutex;  // Guards the stop flag.
+    condition_variable m_cv;  // Wakes up the writer.
+    bool m_bStop;  // Indicates whether the writer should stop.
+    thread m_thread;  // Writer.
+};
+
+// Initialization of static members.
+atomic< int > CIXLog::s_iLevel( static_cast< int >( CIXLog::Level::Info ) );
+
+// Logs a message of the specified level, e.g. IX_LOG( Info, "Committed at ts( " << lt.Get() << " )." ).
+// The message is formatted only if the level is enabled, and not compiled at all above IX_LOG_COMPILED_LEVEL.
+#define IX_LOG( level, message ) \
+    do \
+    { \
+        if constexpr( static_cast< int >( CIXLog::Level::level ) <= IX_LOG_COMPILED_LEVEL ) \
+        { \
+            if( CIXLog::IsEnabled( CIXLog::Level::level ) ) \
+            { \
+                ostringstream& ossLog = CIXLog::BeginMessage(); \
+                ossLog << message; \
+                CIXLog::EndMessage( ossLog ); \
+            } \
+        } \
+    } while( false )
+
 // Logical timestamp.
 class CLogicalTimestamp
 {
@@ -128,6 +498,211 @@ private:
     CLogicalTimestamp m_lt;  // Timestamp.
 };
 
+// Allocator for arrays aligned to the cache line, which also suits the vector registers.
+template< typename T >
+class CIXAlignedAllocator
+{
+public:
+
+    // Allocator traits.
+    typedef T value_type;
+
+    // Alignment in bytes.
+    static const size_t c_stAlignment = 64;
+
+    // Constructors.
+    CIXAlignedAllocator() {}
+    template< typename U > CIXAlignedAllocator( const CIXAlignedAllocator< U >& ) {}
+
+    // Allocates the specified number of elements.
+    T* allocate( size_t stCount )
+    {
+        return static_cast< T* >( ::operator new( stCount * sizeof( T ), align_val_t( c_stAlignment ) ) );
+    }
+
+    // Releases the elements.
+    void deallocate( T* p, size_t )
+    {
+        ::operator delete( p, align_val_t( c_stAlignment ) );  // void
+    }
+
+    // All instances are interchangeable.
+    template< typename U > bool operator==( const CIXAlignedAllocator< U >& ) const { return true; }
+};
+
+// Read-only view of indexable items stored column by column.
+class CIXItemColumnsView
+{
+public:
+
+    // Constructor.
+    CIXItemColumnsView( const int* pI, const int* pJ, const int* pK, const int* pTimestamps, size_t stSize )
+        : m_pI( pI ), m_pJ( pJ ), m_pK( pK ), m_pTimestamps( pTimestamps ), m_stSize( stSize )
+    {
+    }
+
+    // Default constructor.
+    CIXItemColumnsView() : CIXItemColumnsView( nullptr, nullptr, nullptr, nullptr, 0 ) {}
+
+    // Gets the number of items.
+    size_t GetSize() const { return m_stSize; }
+    bool IsEmpty() const { return m_stSize == 0; }
+
+    // Accesses the columns.
+    const int* AccessI() const { return m_pI; }
+    const int* AccessJ() const { return m_pJ; }
+    const int* AccessK() const { return m_pK; }
+    const int* AccessTimestamps() const { return m_pTimestamps; }
+
+    // Gets the specified item as a row.
+    CIXItem Row( size_t stItem ) const
+    {
+        return CIXItem( m_pI[ stItem ], m_pJ[ stItem ], m_pK[ stItem ], CLogicalTimestamp( m_pTimestamps[ stItem ] ) );
+    }
+
+    // Gets the view of the items starting from the specified one.
+    CIXItemColumnsView Subview( size_t stOffset ) const
+    {
+        _ASSERTE( stOffset <= m_stSize );
+        return CIXItemColumnsView( m_pI + stOffset, m_pJ + stOffset, m_pK + stOffset, m_pTimestamps + stOffset,
+                m_stSize - stOffset );
+    }
+
+private:
+    const int* m_pI;  // Indexable data.
+    const int* m_pJ;  // Indexable data.
+    const int* m_pK;  // Indexable data.
+    const int* m_pTimestamps;  // Timestamp values.
+    size_t m_stSize;  // Number of items.
+};
+
+// Indexable items stored column by column in separate aligned arrays. Compared to the rows of
+// CIXItem, there is no per-item vtable pointer or padding and the columns can be copied and
+// processed as plain arrays. The items may also be borrowed from columns held elsewhere, e.g.
+// in a mapped file, in which case they are copied only if modified.
+class CIXItemColumns
+{
+public:
+
+    // Helper types.
+    typedef vector< int, CIXAlignedAllocator< int > > Column;
+
+    // Constructor.
+    CIXItemColumns()
+        : m_bBorrowed( false )
+    {
+    }
+
+    // Removes the items. The columns keep their capacity.
+    void Clear()
+    {
+        m_vecI.clear();
+        m_vecJ.clear();
+        m_vecK.clear();
+        m_vecTimestamps.clear();
+        m_bBorrowed = false;
+    }
+
+    // Refers to the specified columns instead of holding the items. The columns must stay
+    // valid and unchanged until the items are cleared or replaced.
+    void Borrow( const CIXItemColumnsView& columns )
+    {
+        Clear();  // void
+        m_viewBorrowed = columns;
+        m_bBorrowed = true;
+    }
+
+    // Drops the items after the specified number of items.
+    void Truncate( size_t stCount )
+    {
+        // Narrow the view or shrink the columns.
+        if( stCount >= GetSize() )
+            return;
+        if( m_bBorrowed )
+        {
+            m_viewBorrowed = CIXItemColumnsView( m_viewBorrowed.AccessI(), m_viewBorrowed.AccessJ(), m_viewBorrowed.AccessK(),
+                    m_viewBorrowed.AccessTimestamps(), stCount );
+            return;
+
+        }  // end if
+        m_vecI.resize( stCount );
+        m_vecJ.resize( stCount );
+        m_vecK.resize( stCount );
+        m_vecTimestamps.resize( stCount );
+    }
+
+    // Reserves capacity for the specified number of items.
+    void Reserve( size_t stCount )
+    {
+        m_vecI.reserve( stCount );
+        m_vecJ.reserve( stCount );
+        m_vecK.reserve( stCount );
+        m_vecTimestamps.reserve( stCount );
+    }
+
+    // Appends an item.
+    void Append( int i, int j, int k, const CLogicalTimestamp& lt )
+    {
+        if( m_bBorrowed )
+            Assign( m_viewBorrowed );  // void
+        m_vecI.push_back( i );
+        m_vecJ.push_back( j );
+        m_vecK.push_back( k );
+        m_vecTimestamps.push_back( lt.Get() );
+    }
+
+    // Replaces the items with the specified rows.
+    void Assign( span< const CIXItem > items )
+    {
+        Clear();  // void
+        Reserve( items.size() );  // void
+        for( const CIXItem& item : items )
+            Append( item.GetI(), item.GetJ(), item.GetK(), item.AccessLT() );  // void
+    }
+
+    // Replaces the items with a copy of the specified columns.
+    void Assign( const CIXItemColumnsView& columns )
+    {
+        // Copy the columns as plain arrays.
+        size_t stCount = columns.GetSize();
+        m_vecI.resize( stCount );
+        m_vecJ.resize( stCount );
+        m_vecK.resize( stCount );
+        m_vecTimestamps.resize( stCount );
+        if( stCount > 0 )
+        {
+            memcpy( m_vecI.data(), columns.AccessI(), stCount * sizeof( int ) );
+            memcpy( m_vecJ.data(), columns.AccessJ(), stCount * sizeof( int ) );
+            memcpy( m_vecK.data(), columns.AccessK(), stCount * sizeof( int ) );
+            memcpy( m_vecTimestamps.data(), columns.AccessTimestamps(), stCount * sizeof( int ) );
+
+        }  // end if
+        m_bBorrowed = false;
+    }
+
+    // Gets the number of items.
+    size_t GetSize() const { return m_bBorrowed ? m_viewBorrowed.GetSize() : m_vecTimestamps.size(); }
+
+    // Gets the specified item as a row.
+    CIXItem Row( size_t stItem ) const { return View().Row( stItem ); }
+
+    // Gets the view of all items.
+    CIXItemColumnsView View() const
+    {
+        if( m_bBorrowed )
+            return m_viewBorrowed;
+        return CIXItemColumnsView( m_vecI.data(), m_vecJ.data(), m_vecK.data(), m_vecTimestamps.data(), GetSize() );
+    }
+
+private:
+    Column m_vecI;  // Indexable data.
+    Column m_vecJ;  // Indexable data.
+    Column m_vecK;  // Indexable data.
+    Column m_vecTimestamps;  // Timestamp values.
+    CIXItemColumnsView m_viewBorrowed;  // Borrowed items, if any.
+    bool m_bBorrowed;  // Indicates whether the items are borrowed.
+};
+
 // Generic result with a built-in success code.
 template< typename T >
 class CResult
@@ -179,6 +754,34 @@ namespace
 #define IX_TRY( res ) IX_TRY_IMPL( res, __LINE__ )
 #define IX_UP_TRY( up ) IX_UP_TRY_IMPL( std::move( up ), __LINE__ )
 
+// Indexable item prepared for indexing.
+class CIXPreparedData
+{
+public:
+
+    // Number of indexable fields per item.
+    static const int c_iFields = 3;
+
+    // Constructor.
+    CIXPreparedData( const CIXItem& item, uint32_t uKeyI, uint32_t uKeyJ, uint32_t uKeyK )
+        : m_item( item ), m_rguKeys{ uKeyI, uKeyJ, uKeyK }
+    {
+    }
+
+    // Default constructor.
+    CIXPreparedData() : CIXPreparedData( CIXItem(), 0, 0, 0 ) {}
+
+    // Accesses the original item.
+    const CIXItem& AccessItem() const { return m_item; }
+
+    // Gets the derived key of the specified field.
+    uint32_t GetKey( int iField ) const { return m_rguKeys[ iField ]; }
+
+private:
+    CIXItem m_item;  // Original item.
+    uint32_t m_rguKeys[ c_iFields ];  // Derived keys by field.
+};
+
 // Indexing engine interface.
 class IIXIndexing
 {
@@ -190,7 +793,47 @@ public:
     // Indexes data.
     virtual bool Index( const CIXItem& item ) = 0;
 
-    // Commits the current state.
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > items )
+    {
+        // Default to indexing the items one by one.
+        bool bSuccess = true;
+        for( const CIXItem& item : items )
+        {
+            if( Index( item ) == false )
+                bSuccess = false;
+        }
+        return bSuccess;
+    }
+
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& columns )
+    {
+        // Default to indexing the rows one by one.
+        bool bSuccess = true;
+        for( size_t stItem = 0; stItem < columns.GetSize(); stItem++ )
+        {
+            if( Index( columns.Row( stItem ) ) == false )
+                bSuccess = false;
+        }
+        return bSuccess;
+    }
+
+    // Indexes a batch of prepared data.
+    virtual bool IndexPrepared( span< const CIXPreparedData > data )
+    {
+        // Default to indexing the original items one by one.
+        bool bSuccess = true;
+        for( const CIXPreparedData& prepared : data )
+        {
+            if( Index( prepared.AccessItem() ) == false )
+                bSuccess = false;
+        }
+        return bSuccess;
+    }
+
+    // Commits the current state. With asynchronous commits, this is called from
+    // a background thread concurrently with the indexing calls.
     virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) = 0;
 
     // Destructor.
@@ -199,84 +842,152 @@ public:
     }
  };
 
-// Helper class for reporting object lifecycles.
-class CLifeReporter
+// Switch for tracking the object lifecycles. Without it, the tracking is compiled out entirely.
+#ifndef IX_LIFE_REPORTING
+#define IX_LIFE_REPORTING 1
+#endif
+
+// Lifecycle counters of a class. The counters are allocated statically for each tracked class
+// and linked to the list of all counters on the first construction, so that tracking an object
+// costs a few relaxed atomic operations and never a lookup or an allocation.
+class CLifeCounters
 {
 public:
 
     // Constructor.
-    CLifeReporter()
-    {
-    }
-
-    // Destructor.
-    virtual ~CLifeReporter()
+    constexpr CLifeCounters()
+        : m_pszClass( nullptr ), m_pNext( nullptr ), m_bRegistered( false ),
+          m_iConstructions( 0 ), m_iDestructions( 0 ), m_iLive( 0 ), m_iPeak( 0 )
     {
     }
 
     // Tracks a constructor call.
-    static void ConstructorCalled( const char* pszClass )
+    void ConstructorCalled( const char* pszClass )
     {
-        // Track.
-        s_mapCreated[ pszClass ]++;
+        // Register on the first call.
+        if( m_bRegistered.load( memory_order_relaxed ) == false && m_bRegistered.exchange( true ) == false )
+            Register( pszClass );  // void
+
+        // Count and track the peak.
+        m_iConstructions.fetch_add( 1, memory_order_relaxed );  // Return value ignored.
+        int iLive = m_iLive.fetch_add( 1, memory_order_relaxed ) + 1;
+        int iPeak = m_iPeak.load( memory_order_relaxed );
+        while( iLive > iPeak && m_iPeak.compare_exchange_weak( iPeak, iLive, memory_order_relaxed ) == false )
+        {
+        }
     }
 
     // Tracks a destructor call.
-    static void DestructorCalled( const char* pszClass )
+    void DestructorCalled()
     {
-        // Track.
-        s_mapDestroyed[ pszClass ]++;
+        // Count.
+        m_iDestructions.fetch_add( 1, memory_order_relaxed );  // Return value ignored.
+        m_iLive.fetch_sub( 1, memory_order_relaxed );  // Return value ignored.
     }
 
-    // Runs the report.
-    static void Report()
-    {
-        // Find out the longest class name.
-        size_t stMaxLen = 0;
-        for( const auto& p : s_mapCreated )
-            stMaxLen = std::max( stMaxLen, p.first.length() );
-        size_t stMaxLogicalIndents = ( stMaxLen + 1 ) / 3;
+    // Accesses the first registered counters.
+    static const CLifeCounters* AccessFirst() { return s_pFirst.load( memory_order_acquire ); }
 
-        // Loop through creations.
-        cout << endl;
-        for( const auto& p : s_mapCreated )
-        {
-            // Locals.
-            string szClass = p.first;
-            int iConstructions = p.second;
-            int iDestructions = 0;
-            int iSaldo = iConstructions;
-
-            // Try to find matching destructions.
-            map< string, int >::const_iterator q = s_mapDestroyed.find( szClass );
-            if( q != s_mapDestroyed.end() )
-            {
-                // Collect the information.
-                iDestructions = q->second;
-                iSaldo = iConstructions - iDestructions;
+    // Accesses the next registered counters.
+    const CLifeCounters* AccessNext() const { return m_pNext; }
 
-            }  // end if
+    // Accesses the class name.
+    const char* AccessClass() const { return m_pszClass; }
 
-            // Output the info.
-            size_t stAdditionalIndentsRequired = stMaxLogicalIndents - ( ( szClass.length() + 1 ) / 3 );
-            cout << szClass << ":" <<
-                    Indent( stAdditionalIndentsRequired ) <<
-                    "\t" << iSaldo << " remaining" << 
-                    "\t" << iConstructions << " up, " << 
-                    "\t" << iDestructions << " down." <<
-                    endl;
+    // Returns the number of constructions.
+    int GetConstructions() const { return m_iConstructions.load( memory_order_relaxed ); }
 
-        }  // end for
+    // Returns the number of destructions.
+    int GetDestructions() const { return m_iDestructions.load( memory_order_relaxed ); }
+
+    // Returns the highest number of objects alive at once.
+    int GetPeak() const { return m_iPeak.load( memory_order_relaxed ); }
+
+private:
+
+    // Links the counters to the list.
+    void Register( const char* pszClass )
+    {
+        m_pszClass = pszClass;
+        CLifeCounters* pFirst = s_pFirst.load( memory_order_relaxed );
+        do
+        {
+            m_pNext = pFirst;
+        }
+        while( s_pFirst.compare_exchange_weak( pFirst, this, memory_order_release, memory_order_relaxed ) == false );
     }
 
-protected:
-    static map< string, int > s_mapCreated;  // Creations by class.
-    static map< string, int > s_mapDestroyed;  // Destructions by class.
+private:
+    static atomic< CLifeCounters* > s_pFirst;  // First registered counters.
+    const char* m_pszClass;  // Class name.
+    CLifeCounters* m_pNext;  // Next registered counters.
+    atomic< bool > m_bRegistered;  // Indicates whether the counters are registered.
+    atomic< int > m_iConstructions;  // Number of constructions.
+    atomic< int > m_iDestructions;  // Number of destructions.
+    atomic< int > m_iLive;  // Number of objects alive.
+    atomic< int > m_iPeak;  // Highest number of objects alive at once.
 };
 
 // Initialization of static members.
-map< string, int > CLifeReporter::s_mapCreated;
-map< string, int > CLifeReporter::s_mapDestroyed;
+constinit atomic< CLifeCounters* > CLifeCounters::s_pFirst( nullptr );
+
+// Helper class for reporting object lifecycles.
+class CLifeReporter
+{
+public:
+
+    // Constructor.
+    CLifeReporter()
+    {
+    }
+
+    // Destructor.
+    virtual ~CLifeReporter()
+    {
+    }
+
+    // Runs the report.
+    static void Report()
+    {
+        // Collect the tracked classes in name order.
+        vector< const CLifeCounters* > vecCounters;
+        for( const CLifeCounters* pCounters = CLifeCounters::AccessFirst(); pCounters != nullptr; pCounters = pCounters->AccessNext() )
+            vecCounters.push_back( pCounters );
+        sort( vecCounters.begin(), vecCounters.end(), []( const CLifeCounters* pLeft, const CLifeCounters* pRight )
+                { return strcmp( pLeft->AccessClass(), pRight->AccessClass() ) < 0; } );
+
+        // Find out the longest class name.
+        size_t stMaxLen = 0;
+        for( const CLifeCounters* pCounters : vecCounters )
+            stMaxLen = std::max( stMaxLen, strlen( pCounters->AccessClass() ) );
+        size_t stMaxLogicalIndents = ( stMaxLen + 1 ) / 3;
+
+        // Loop through the classes, after the log messages so far.
+        CIXLog::Flush();  // void
+        if( vecCounters.empty() )
+            return;
+        cout << endl;
+        for( const CLifeCounters* pCounters : vecCounters )
+        {
+            // Locals.
+            string szClass = pCounters->AccessClass();
+            int iConstructions = pCounters->GetConstructions();
+            int iDestructions = pCounters->GetDestructions();
+            int iSaldo = iConstructions - iDestructions;
+
+            // Output the info.
+            size_t stAdditionalIndentsRequired = stMaxLogicalIndents - ( ( szClass.length() + 1 ) / 3 );
+            cout << szClass << ":" <<
+                    Indent( stAdditionalIndentsRequired ) <<
+                    "\t" << iSaldo << " remaining" << 
+                    "\t" << iConstructions << " up, " << 
+                    "\t" << iDestructions << " down," <<
+                    "\t" << pCounters->GetPeak() << " at peak." <<
+                    endl;
+
+        }  // end for
+    }
+};
 
 // Helper class for tracking object lifecycles.
 template< typename T >
@@ -287,18 +998,92 @@ public:
     // Constructor.
     CLifeReporterAgent()
     {
+#if IX_LIFE_REPORTING
         // Track.
-        CLifeReporter::ConstructorCalled( typeid( T ).name() );  // void
+        s_counters.ConstructorCalled( typeid( T ).name() );  // void
+#endif
     }
 
     // Destructor.
     virtual ~CLifeReporterAgent()
     {
+#if IX_LIFE_REPORTING
         // Track.
-        CLifeReporter::DestructorCalled( typeid( T ).name() );  // void
+        s_counters.DestructorCalled();  // void
+#endif
     }
+
+#if IX_LIFE_REPORTING
+private:
+    static CLifeCounters s_counters;  // Counters of the class.
+#endif
+};
+
+#if IX_LIFE_REPORTING
+// Initialization of static members.
+template< typename T >
+constinit CLifeCounters CLifeReporterAgent< T >::s_counters;
+#endif
+
+// Switch for counting the heap allocations of each thread. It replaces the global allocation
+// functions, so it is off by default and on in the Benchmark configuration. Without it, the
+// benchmarks report no allocation counts.
+#ifndef IX_ALLOCATION_COUNTING
+#define IX_ALLOCATION_COUNTING 0
+#endif
+
+// Heap allocation counter of the calling thread.
+class CIXAllocationCounter
+{
+public:
+
+    // Returns the number of allocations the calling thread has made.
+    static uint64_t Get() { return s_uAllocations; }
+
+    // Indicates whether the allocations are counted.
+    static constexpr bool IsEnabled() { return IX_ALLOCATION_COUNTING != 0; }
+
+    // Counts an allocation.
+    static void Count() { s_uAllocations++; }
+
+private:
+    static thread_local uint64_t s_uAllocations;  // Allocations of the thread.
 };
 
+// Initialization of static members.
+thread_local uint64_t CIXAllocationCounter::s_uAllocations = 0;
+
+#if IX_ALLOCATION_COUNTING
+#ifdef _MSC_VER
+#define IX_NOINLINE __declspec( noinline )
+#else
+#define IX_NOINLINE __attribute__(( noinline ))
+#endif
+
+// Replaced global allocation functions. The array and the non-throwing forms forward to these.
+// They are kept out of line, so the compiler sees them as a matching pair.
+IX_NOINLINE void* operator new( size_t stSize )
+{
+    // Count and allocate.
+    CIXAllocationCounter::Count();  // void
+    if( void* pv = malloc( stSize == 0 ? 1 : stSize ) )
+        return pv;
+    throw bad_alloc();
+}
+
+IX_NOINLINE void operator delete( void* pv ) noexcept
+{
+    // Release.
+    free( pv );  // void
+}
+
+IX_NOINLINE void operator delete( void* pv, size_t ) noexcept
+{
+    // Release.
+    free( pv );  // void
+}
+#endif
+
 // Indexing engine implementation.
 class CIXIndexing : public IIXIndexing, public CLifeReporterAgent< CIXIndexing >
 {
@@ -313,7 +1098,7 @@ public:
     // Destructor.
     virtual ~CIXIndexing()
     {
-        cout << endl << "Indexed " << m_iItemsIndexed << " items." << endl;
+        IX_LOG( Info, endl << "Indexed " << m_iItemsIndexed << " items." );
     }
 
 // IIXIndexing
@@ -322,19 +1107,8 @@ public:
     // Indexes data.
     virtual bool Index( const CIXItem& item ) override
     {
-        // Debug output.
-        cout << Indent( 3 )
-            << "ts( "
-            << item.AccessLT().Get()
-            << " ), data( "
-            << item.GetI()
-            << ","
-            << item.GetJ()
-            << ","
-            << item.GetK()
-            << " )"
-            << " ...indexed."
-            << endl;
+        // Delegate.
+        Trace( item );  // void
 
         // Increase the overall counter.
         m_iItemsIndexed++;
@@ -342,939 +1116,7828 @@ public:
         return true;
     }
 
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > items ) override
+    {
+        // Trace the items.
+        for( const CIXItem& item : items )
+            Trace( item );  // void
+
+        // Increase the overall counter once for the whole batch.
+        m_iItemsIndexed += static_cast< int >( items.size() );
+
+        return true;
+    }
+
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& columns ) override
+    {
+        // Trace the items.
+        for( size_t stItem = 0; stItem < columns.GetSize(); stItem++ )
+            Trace( columns.Row( stItem ) );  // void
+
+        // Increase the overall counter once for the whole batch.
+        m_iItemsIndexed += static_cast< int >( columns.GetSize() );
+
+        return true;
+    }
+
     // Commits the current state.
     virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) override
     {
         // Report the commit.
-        cout << "Committed at ts( " << lt.Get() << " ) after " << iActualCount << " items." << endl;
+        IX_LOG( Info, "Committed at ts( " << lt.Get() << " ) after " << iActualCount << " items." );
         return true;
     }
 
+private:
+
+    // Outputs the indexed item.
+    void Trace( const CIXItem& item )
+    {
+        // Debug output.
+        IX_LOG( Trace, Indent( 3 )
+            << "ts( "
+            << item.AccessLT().Get()
+            << " ), data( "
+            << item.GetI()
+            << ","
+            << item.GetJ()
+            << ","
+            << item.GetK()
+            << " )"
+            << " ...indexed." );
+    }
+
 private:
     int m_iItemsIndexed;  // Number of indexed items.
 };
 
-// Data retrieval interface.
-class IIXDataRetrieval
+// Data preparation interface.
+class IIXDataPreparation
 {
 public:
 
     // Helper types.
-    typedef shared_ptr< IIXDataRetrieval > SHP;
+    typedef shared_ptr< IIXDataPreparation > SHP;
 
-    // Returns the number of items globally available.
-    virtual int GetGloballyAvailable() = 0;
-
-    // Retrieves data.
-    virtual CResult< CLogicalTimestamp > RetrieveData(
-        const CLogicalTimestamp& ltLatestSeen,
-        int iCount,
-        OUT bool& bExhausted,
-        OUT vector< CIXItem >& vecItems
-    ) = 0;
+    // Prepares an item for indexing.
+    virtual CIXPreparedData Prepare( const CIXItem& item ) = 0;
 
-    // Destructor.
-    virtual ~IIXDataRetrieval()
+    // Prepares a batch of items for indexing.
+    virtual void PrepareBatch( span< const CIXItem > items, OUT vector< CIXPreparedData >& vecPrepared )
     {
+        // Default to preparing the items one by one.
+        vecPrepared.clear();
+        for( const CIXItem& item : items )
+            vecPrepared.push_back( Prepare( item ) );
     }
-};
-
-// Helper class to encapsulate the data availability status during enumeration.
-class CIXAvailability
-{
-public:
-
-    // Availability status values.
-    enum class Available { Yes, Perhaps, No };
 
-    // Constructor.
-    CIXAvailability( Available available, const CLogicalTimestamp& ltLatestKnown ) :
-        m_available( available ), m_ltLatestKnown( ltLatestKnown )
+    // Prepares a batch of items held column by column for indexing.
+    virtual void PrepareColumns( const CIXItemColumnsView& columns, OUT vector< CIXPreparedData >& vecPrepared )
     {
+        // Default to preparing the rows one by one.
+        vecPrepared.clear();
+        for( size_t stItem = 0; stItem < columns.GetSize(); stItem++ )
+            vecPrepared.push_back( Prepare( columns.Row( stItem ) ) );
     }
 
-    // Default constructor.
-    CIXAvailability() :
-        m_available( Available::No )
+    // Destructor.
+    virtual ~IIXDataPreparation()
     {
     }
-
-    // Accesses the availability status.
-    Available AccessAvailability() const { return m_available;  }
-
-    // Accesses the latest known timestamp value.
-    const CLogicalTimestamp& AccessLatestKnownTimestamp() const { return m_ltLatestKnown; }
-
-private:
-    Available m_available;  // Availability status.
-    CLogicalTimestamp m_ltLatestKnown;  // Latest known timestamp.
 };
 
-// Data retrieval implementation.
-class CIXDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXDataRetrieval >
+// Kernels deriving the index keys and hash buckets of the field values of a whole batch at once.
+// The widest instruction set supported by the processor is selected at runtime.
+class CIXKeyKernels
 {
 public:
 
-    // Constructor.
-    CIXDataRetrieval()
-        : m_iTotalCount( 0 ), m_iAcceptanceThreshold( 0 )
+    // Helper types.
+    typedef vector< uint32_t, CIXAlignedAllocator< uint32_t > > Keys;
+
+    // Kernel signature.
+    typedef void ( *FnDerive )( int iField, const int* piValues, size_t stCount, uint32_t uBucketMask,
+            OUT uint32_t* puKeys, OUT uint32_t* puBuckets );
+
+    // Derives the key of the specified field value (MurmurHash3 finalizer over the value mixed
+    // with a per-field seed). All kernels produce the same keys.
+    static uint32_t DeriveKey( int iField, int iValue )
     {
-        // Define the random number range.
-        m_distr = std::uniform_int_distribution< int >( 1, 100 );
+        uint32_t u = static_cast< uint32_t >( iValue ) ^ GetSeed( iField );
+        u ^= u >> 16;
+        u *= 0x85EBCA6Bu;
+        u ^= u >> 13;
+        u *= 0xC2B2AE35u;
+        u ^= u >> 16;
+        return u;
     }
 
-    // Destructor.
-    virtual ~CIXDataRetrieval()
+    // Derives the keys of the specified field values, and the buckets ( key & mask ) unless
+    // the bucket output is null.
+    static void Derive( int iField, const int* piValues, size_t stCount, uint32_t uBucketMask,
+            OUT uint32_t* puKeys, OUT uint32_t* puBuckets )
     {
+        // Delegate to the kernel selected on the first call.
+        static const FnDerive s_fnDerive = Select();
+        s_fnDerive( iField, piValues, stCount, uBucketMask, OUT puKeys, OUT puBuckets );  // void
     }
 
-// IIXDataRetrieval
-public:
+private:
 
-    // Returns the number of items globally available.
-    virtual int GetGloballyAvailable() override
+    // Gets the seed of the specified field.
+    static uint32_t GetSeed( int iField )
     {
-        return 81;
+        return 0x9E3779B9u * static_cast< uint32_t >( iField + 1 );
     }
 
-    // Retrieves data.
-    virtual CResult< CLogicalTimestamp > RetrieveData(
-        const CLogicalTimestamp& ltLatestSeen,
-        int iCount,
-        OUT bool& bExhausted,
-        OUT vector< CIXItem >& vecItems
-    ) override
+    // Portable kernel, also used for the tails of the vector kernels.
+    static void DeriveScalar( int iField, const int* piValues, size_t stCount, uint32_t uBucketMask,
+            OUT uint32_t* puKeys, OUT uint32_t* puBuckets )
     {
-        // Reset out params.
-        bExhausted = false;
-        vecItems.clear();
-
-        // Latest known timestamp after the initial threshold.
-        CLogicalTimestamp ltLatestKnown = ltLatestSeen;
-
-        // Determine the timestamp threshold.
-        int iStart = ltLatestSeen.Get() + 1;
+        for( size_t st = 0; st < stCount; st++ )
+        {
+            puKeys[ st ] = DeriveKey( iField, piValues[ st ] );
+            if( puBuckets )
+                puBuckets[ st ] = puKeys[ st ] & uBucketMask;
+        }
+    }
 
-        // Retrieve the data.
-        vecItems.reserve( iCount * 2 );
-        int iItem = 0;
-        for( iItem = iStart; iItem < iStart + iCount; iItem++ )
+#ifdef IX_SIMD_X86
+    // AVX2 kernel, 8 values per step.
+    IX_TARGET( "avx2" )
+    static void DeriveAVX2( int iField, const int* piValues, size_t stCount, uint32_t uBucketMask,
+            OUT uint32_t* puKeys, OUT uint32_t* puBuckets )
+    {
+        // Same steps as DeriveKey.
+        const __m256i vSeed = _mm256_set1_epi32( static_cast< int >( GetSeed( iField ) ) );
+        const __m256i vC1 = _mm256_set1_epi32( static_cast< int >( 0x85EBCA6Bu ) );
+        const __m256i vC2 = _mm256_set1_epi32( static_cast< int >( 0xC2B2AE35u ) );
+        const __m256i vMask = _mm256_set1_epi32( static_cast< int >( uBucketMask ) );
+        size_t st = 0;
+        for( ; st + 8 <= stCount; st += 8 )
         {
-            // Check the overall availability of data.
-            if( m_iTotalCount >= GetGloballyAvailable() )
-            {
-                bExhausted = true;
-                break;
+            __m256i v = _mm256_xor_si256( _mm256_loadu_si256( reinterpret_cast< const __m256i* >( piValues + st ) ), vSeed );
+            v = _mm256_xor_si256( v, _mm256_srli_epi32( v, 16 ) );
+            v = _mm256_mullo_epi32( v, vC1 );
+            v = _mm256_xor_si256( v, _mm256_srli_epi32( v, 13 ) );
+            v = _mm256_mullo_epi32( v, vC2 );
+            v = _mm256_xor_si256( v, _mm256_srli_epi32( v, 16 ) );
+            _mm256_storeu_si256( reinterpret_cast< __m256i* >( puKeys + st ), v );
+            if( puBuckets )
+                _mm256_storeu_si256( reinterpret_cast< __m256i* >( puBuckets + st ), _mm256_and_si256( v, vMask ) );
 
-            }  // end if
+        }  // end for
 
-            // Store the data.
-            ltLatestKnown = CLogicalTimestamp( iItem );
-            if( m_distr( m_rd ) > m_iAcceptanceThreshold )
-                vecItems.push_back( CIXItem( iItem * 2, iItem * 3, iItem * 4, ltLatestKnown ) );
+        // Tail.
+        DeriveScalar( iField, piValues + st, stCount - st, uBucketMask,
+                OUT puKeys + st, OUT puBuckets ? puBuckets + st : nullptr );  // void
+    }
 
-            // Keep track of the count.
-            m_iTotalCount++;
+    // AVX-512 kernel, 16 values per step.
+    IX_TARGET( "avx512f" )
+    static void DeriveAVX512( int iField, const int* piValues, size_t stCount, uint32_t uBucketMask,
+            OUT uint32_t* puKeys, OUT uint32_t* puBuckets )
+    {
+        // Same steps as DeriveKey.
+        const __m512i vSeed = _mm512_set1_epi32( static_cast< int >( GetSeed( iField ) ) );
+        const __m512i vC1 = _mm512_set1_epi32( static_cast< int >( 0x85EBCA6Bu ) );
+        const __m512i vC2 = _mm512_set1_epi32( static_cast< int >( 0xC2B2AE35u ) );
+        const __m512i vMask = _mm512_set1_epi32( static_cast< int >( uBucketMask ) );
+        size_t st = 0;
+        for( ; st + 16 <= stCount; st += 16 )
+        {
+            __m512i v = _mm512_xor_si512( _mm512_loadu_si512( piValues + st ), vSeed );
+            v = _mm512_xor_si512( v, _mm512_srli_epi32( v, 16 ) );
+            v = _mm512_mullo_epi32( v, vC1 );
+            v = _mm512_xor_si512( v, _mm512_srli_epi32( v, 13 ) );
+            v = _mm512_mullo_epi32( v, vC2 );
+            v = _mm512_xor_si512( v, _mm512_srli_epi32( v, 16 ) );
+            _mm512_storeu_si512( puKeys + st, v );
+            if( puBuckets )
+                _mm512_storeu_si512( puBuckets + st, _mm512_and_si512( v, vMask ) );
 
         }  // end for
-        
-        // Debug output.
-        cout << Indent( 2 ) <<
-                "Retrieved " <<
-                vecItems.size() <<
-                " items. Latest known timestamp is " <<
-                ltLatestKnown.Get() <<
-                "." <<
-                endl;
 
-        return CResult< CLogicalTimestamp >( true, ltLatestKnown );
+        // Tail.
+        DeriveScalar( iField, piValues + st, stCount - st, uBucketMask,
+                OUT puKeys + st, OUT puBuckets ? puBuckets + st : nullptr );  // void
     }
+#endif
 
-private:
-    int m_iTotalCount;  // Total number of retrieved items.
-    std::random_device m_rd;  // Obtain a random number from hardware.
-	std::uniform_int_distribution< int > m_distr;  // Define the range.
-    int m_iAcceptanceThreshold;  // Acceptance threshold.
+    // Selects the widest kernel the processor and the operating system support.
+    static FnDerive Select()
+    {
+#ifdef IX_SIMD_X86
+#ifdef _MSC_VER
+        // The registers must be enabled by the operating system as well.
+        int rgiRegs[ 4 ] = {};
+        __cpuid( rgiRegs, 0 );
+        if( rgiRegs[ 0 ] < 7 )
+            return &DeriveScalar;
+        __cpuid( rgiRegs, 1 );
+        if( ( rgiRegs[ 2 ] & ( 1 << 27 ) ) == 0 )
+            return &DeriveScalar;
+        unsigned long long ullXCR0 = _xgetbv( 0 );
+        __cpuidex( rgiRegs, 7, 0 );
+        if( ( rgiRegs[ 1 ] & ( 1 << 16 ) ) && ( ullXCR0 & 0xE6 ) == 0xE6 )
+            return &DeriveAVX512;
+        if( ( rgiRegs[ 1 ] & ( 1 << 5 ) ) && ( ullXCR0 & 0x06 ) == 0x06 )
+            return &DeriveAVX2;
+#else
+        // The checks cover the operating system support.
+        __builtin_cpu_init();  // void
+        if( __builtin_cpu_supports( "avx512f" ) )
+            return &DeriveAVX512;
+        if( __builtin_cpu_supports( "avx2" ) )
+            return &DeriveAVX2;
+#endif
+#endif
+        return &DeriveScalar;
+    }
 };
 
-// Callback interface.
-class IIXCallback
+// Data preparation implementation.
+class CIXDataPreparation : public IIXDataPreparation, public CLifeReporterAgent< CIXDataPreparation >
 {
 public:
 
-    // Helper types.
-    typedef shared_ptr< IIXCallback > SHP;
-
-    // Returns the batch size.
-    virtual int GetBatchSize() = 0;
+    // Constructor.
+    CIXDataPreparation()
+    {
+    }
 
-    // Returns the chunk size.
-    virtual int GetChunkSize() = 0;
+    // Destructor.
+    virtual ~CIXDataPreparation()
+    {
+    }
 
-    // Accesses the latest seen timestamp.
-    virtual const CLogicalTimestamp& AccessLatestSeen() const = 0;
+    // Derives the key of the specified field value.
+    static uint32_t DeriveKey( int iField, int iValue )
+    {
+        // Delegate.
+        return CIXKeyKernels::DeriveKey( iField, iValue );
+    }
 
-    // Updates the locally stored timestamp if the provided one is later.
-    virtual void UpdateIfLater( const CLogicalTimestamp& ltProvided ) = 0;
+// IIXDataPreparation
+public:
 
-    // Accesses the data retrieval.
-    virtual const IIXDataRetrieval::SHP AccessDataRetrieval() = 0;
+    // Prepares an item for indexing.
+    virtual CIXPreparedData Prepare( const CIXItem& item ) override
+    {
+        // Derive the keys.
+        return CIXPreparedData( item, DeriveKey( 0, item.GetI() ), DeriveKey( 1, item.GetJ() ), DeriveKey( 2, item.GetK() ) );
+    }
 
-    // Accesses the indexing engine.
-    virtual const IIXIndexing::SHP AccessIndexing() = 0;
+    // Prepares a batch of items for indexing.
+    virtual void PrepareBatch( span< const CIXItem > items, OUT vector< CIXPreparedData >& vecPrepared ) override
+    {
+        // Turn the rows into columns for the kernels. Called concurrently by the pipeline
+        // workers, so the buffer is per thread.
+        thread_local CIXItemColumns columns;
+        columns.Assign( items );  // void
+        PrepareColumns( columns.View(), OUT vecPrepared );  // void
+    }
 
-    // Destructor.
-    virtual ~IIXCallback()
+    // Prepares a batch of items held column by column for indexing.
+    virtual void PrepareColumns( const CIXItemColumnsView& columns, OUT vector< CIXPreparedData >& vecPrepared ) override
     {
+        // Derive the keys of each field for the whole batch at once.
+        thread_local CIXKeyKernels::Keys rgvecKeys[ CIXPreparedData::c_iFields ];
+        const int* rgpiValues[ CIXPreparedData::c_iFields ] = { columns.AccessI(), columns.AccessJ(), columns.AccessK() };
+        size_t stCount = columns.GetSize();
+        for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+        {
+            rgvecKeys[ iField ].resize( stCount );
+            CIXKeyKernels::Derive( iField, rgpiValues[ iField ], stCount, 0, OUT rgvecKeys[ iField ].data(), nullptr );  // void
+
+        }  // end for
+
+        // Combine with the items.
+        vecPrepared.clear();
+        vecPrepared.reserve( stCount );
+        for( size_t stItem = 0; stItem < stCount; stItem++ )
+            vecPrepared.push_back( CIXPreparedData( columns.Row( stItem ),
+                    rgvecKeys[ 0 ][ stItem ], rgvecKeys[ 1 ][ stItem ], rgvecKeys[ 2 ][ stItem ] ) );
     }
 };
 
-// Callback implementation.
-class CIXCallback : public IIXCallback, public CLifeReporterAgent< CIXCallback >
+// Bounded multi-producer multi-consumer queue. Waiting threads sleep until signaled.
+template< typename T >
+class CIXBlockingQueue
 {
 public:
 
     // Constructor.
-    CIXCallback( IIXDataRetrieval::SHP shpDataRetrieval, IIXIndexing::SHP shpIndexing, const CLogicalTimestamp& ltLatestSeen )
-        : m_shpDataRetrieval( shpDataRetrieval ), m_shpIndexing( shpIndexing ), m_ltLatestSeen( ltLatestSeen )
+    CIXBlockingQueue( size_t stCapacity )
+        : m_stCapacity( stCapacity ), m_bClosed( false )
     {
+        _ASSERTE( m_stCapacity > 0 );
     }
 
-    // Destructor.
-    virtual ~CIXCallback()
+    // Adds an element, waiting while full.
+    void Push( const T& t )
     {
+        // Wait for room.
+        {
+            unique_lock< mutex > lock( m_mutex );
+            m_cvNotFull.wait( lock, [ & ] { return m_deque.size() < m_stCapacity; } );  // void
+            m_deque.push_back( t );  // void
+        }
+        m_cvNotEmpty.notify_one();  // void
     }
 
-// IIXCallback
-public:
-
-    // Returns the batch size.
-    virtual int GetBatchSize() override
+    // Removes an element, waiting while empty. Returns false once the queue is closed and empty.
+    bool Pop( OUT T& t )
     {
-        // Batch size.
-        return 18;
-    }
-
-    // Returns the chunk size.
-    virtual int GetChunkSize() override
-    { 
-        // Chunk size.
-        return 10; 
+        // Wait for an element.
+        {
+            unique_lock< mutex > lock( m_mutex );
+            m_cvNotEmpty.wait( lock, [ & ] { return m_deque.empty() == false || m_bClosed; } );  // void
+            if( m_deque.empty() )
+                return false;
+            t = m_deque.front();
+            m_deque.pop_front();  // void
+        }
+        m_cvNotFull.notify_one();  // void
+        return true;
     }
 
-    // Accesses the latest seen timestamp.
-    virtual const CLogicalTimestamp& AccessLatestSeen() const override
+    // Closes the queue, waking all consumers once the remaining elements are taken.
+    void Close()
     {
-        // Access the timestamp.
-        return m_ltLatestSeen;
+        // Signal.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_bClosed = true;
+        }
+        m_cvNotEmpty.notify_all();  // void
     }
 
-    // Updates the locally stored timestamp if the provided one is later.
-    virtual void UpdateIfLater( const CLogicalTimestamp& ltProvided ) override
+private:
+    mutex m_mutex;  // Protects the members below.
+    condition_variable m_cvNotEmpty;  // Signals the added elements and closing.
+    condition_variable m_cvNotFull;  // Signals the removed elements.
+    deque< T > m_deque;  // Elements.
+    size_t m_stCapacity;  // Maximum number of elements.
+    bool m_bClosed;  // Indicates whether the queue is closed.
+};
+
+// Indexing decorator running the retrieval, preparation and indexing as pipeline stages.
+// The caller's thread is the retrieval stage, the preparation runs on N worker threads and
+// the indexing on a single thread which applies the items and commits in their original order.
+// A commit returns once it has been applied, so that nothing is persisted ahead of the index.
+class CIXPreparationPipeline : public IIXIndexing, public CLifeReporterAgent< CIXPreparationPipeline >
+{
+public:
+
+    // Constructor.
+    CIXPreparationPipeline( IIXIndexing::SHP shpInner, IIXDataPreparation::SHP shpPreparation, int iWorkers, int iUnits = 64 )
+        : m_shpInner( shpInner ), m_shpPreparation( shpPreparation ),
+          m_queueFree( iUnits ), m_queuePrepare( iUnits ), m_queueIndex( iUnits ),
+          m_stWindow( 0 ), m_stNextSequence( 0 ), m_stIndexed( 0 ), m_bFailedSinceCommit( false ), m_bFailed( false )
     {
-        // Delegate to the timestamp.
-        m_ltLatestSeen.UpdateIfLater( ltProvided );  // void
+        // Allocate the work units. Their number bounds the items in flight.
+        _ASSERTE( m_shpInner && m_shpPreparation && iWorkers > 0 && iUnits > 0 );
+        m_vecUnits.resize( iUnits );
+        for( Unit& unit : m_vecUnits )
+            m_queueFree.Push( &unit );  // void
+        m_stWindow = m_vecUnits.size();
+        m_vecReorder.resize( m_stWindow, nullptr );
+
+        // Start the stages.
+        for( int iWorker = 0; iWorker < iWorkers; iWorker++ )
+            m_vecWorkers.push_back( thread( &CIXPreparationPipeline::PrepareStage, this ) );
+        m_threadIndex = thread( &CIXPreparationPipeline::IndexStage, this );
     }
 
-    // Accesses the data source.
-    virtual const IIXDataRetrieval::SHP AccessDataRetrieval() override
+    // Destructor.
+    virtual ~CIXPreparationPipeline()
     {
-        // Access the data retrieval.
-        return m_shpDataRetrieval;
+        // Drain the pipeline and stop the stages.
+        Flush();  // void
+        m_queuePrepare.Close();  // void
+        for( thread& t : m_vecWorkers )
+            t.join();
+        m_queueIndex.Close();  // void
+        m_threadIndex.join();
     }
 
-    // Accesses the indexing engine.
-    virtual const IIXIndexing::SHP AccessIndexing() override
+    // Waits until everything submitted so far has been indexed and committed.
+    void Flush()
     {
-        // Access the data source.
-        return m_shpIndexing;
+        unique_lock< mutex > lock( m_mutexIndexed );
+        m_cvIndexed.wait( lock, [ & ] { return m_stIndexed == m_stNextSequence.load(); } );  // void
     }
 
-private:
-    IIXDataRetrieval::SHP m_shpDataRetrieval;  // Data retrieval interface.
-    IIXIndexing::SHP m_shpIndexing;  // Indexing engine interface.
-    CLogicalTimestamp m_ltLatestSeen;  // Latest seen timestamp.
-};
-
-// Enumerator interface.
-class IIXEnumerable
-{
+// IIXIndexing
 public:
 
-    // Helper types.
-    typedef shared_ptr< IIXEnumerable > SHP;
-
-    // Helper types.
-    typedef unique_ptr< IIXEnumerable > UP;
+    // Indexes data.
+    virtual bool Index( const CIXItem& item ) override
+    {
+        // Delegate.
+        return IndexBatch( span< const CIXItem >( &item, 1 ) );
+    }
 
-    // Proceeds the enumerator.
-    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen ) = 0;
-    
-    // Gets the current item.
-    virtual CResult< CIXItem > Current() const = 0;
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > items ) override
+    {
+        // Hand the copied items over to the preparation stage.
+        Unit* pUnit = AcquireUnit();
+        pUnit->m_bCommit = false;
+        pUnit->m_bColumnar = false;
+        pUnit->m_vecItems.assign( items.begin(), items.end() );
+        m_queuePrepare.Push( pUnit );  // void
+
+        // Report an earlier failure of the later stages.
+        return m_bFailed.exchange( false ) == false;
+    }
 
-    // Resets the enumerator.
-    virtual void Reset( IIXCallback::SHP shpCB ) = 0;
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& columns ) override
+    {
+        // Hand the copied columns over to the preparation stage.
+        Unit* pUnit = AcquireUnit();
+        pUnit->m_bCommit = false;
+        pUnit->m_bColumnar = true;
+        pUnit->m_columns.Assign( columns );  // void
+        m_queuePrepare.Push( pUnit );  // void
+
+        // Report an earlier failure of the later stages.
+        return m_bFailed.exchange( false ) == false;
+    }
 
-    // Destructor.
-    virtual ~IIXEnumerable()
+    // Commits the current state.
+    virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) override
     {
+        // Commits need no preparation, so they go straight to the indexing stage
+        // which applies them after all the preceding items.
+        Unit* pUnit = AcquireUnit();
+        pUnit->m_bCommit = true;
+        pUnit->m_ltCommit = lt;
+        pUnit->m_iCommitCount = iActualCount;
+        size_t stSequence = pUnit->m_stSequence;
+        m_queueIndex.Push( pUnit );  // void
+
+        // Wait until applied. The indexing stage leaves the commit units to their callers.
+        {
+            unique_lock< mutex > lock( m_mutexIndexed );
+            m_cvIndexed.wait( lock, [ & ] { return m_stIndexed > stSequence; } );  // void
+        }
+        bool bSuccess = pUnit->m_bSuccess;
+        m_queueFree.Push( pUnit );  // void
+        return bSuccess;
     }
-};
 
-// Enumerator object for chunked item data.
-class CIXItemsChunked : public IIXEnumerable, public CLifeReporterAgent< CIXItemsChunked >
-{
-public:
+private:
 
-    // Factory method.
-    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    // Work unit flowing through the stages.
+    struct Unit
     {
-        // Sanity check.
-        if( shpCB == nullptr )
-            return IIXEnumerable::UP();
-
-        // Delegate.
-        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsChunked( shpCB ) ) );
+        size_t m_stSequence = 0;  // Sequence number defining the indexing order.
+        bool m_bCommit = false;  // Indicates a commit instead of items.
+        CLogicalTimestamp m_ltCommit;  // Commit timestamp.
+        int m_iCommitCount = 0;  // Commit item count.
+        bool m_bSuccess = false;  // Result of applying the unit.
+        bool m_bPrepared = false;  // Indicates whether the preparation succeeded.
+        bool m_bColumnar = false;  // Indicates whether the items to prepare are held column by column.
+        vector< CIXItem > m_vecItems;  // Items to prepare.
+        CIXItemColumns m_columns;  // Items to prepare, held column by column.
+        vector< CIXPreparedData > m_vecPrepared;  // Prepared items.
+    };
+
+    // Takes a free work unit, waiting while all are in flight.
+    Unit* AcquireUnit()
+    {
+        // Pop a unit and assign the next sequence number. Commits may be submitted
+        // from another thread than the items, see CIXGroupCommitter.
+        Unit* pUnit = nullptr;
+        m_queueFree.Pop( OUT pUnit );  // Return value ignored.
+        pUnit->m_stSequence = m_stNextSequence.fetch_add( 1 );
+        return pUnit;
     }
 
-    // Destructor.
-    virtual ~CIXItemsChunked()
+    // Preparation stage.
+    void PrepareStage()
     {
+        // Prepare the units until the queue is closed.
+        Unit* pUnit = nullptr;
+        while( m_queuePrepare.Pop( OUT pUnit ) )
+        {
+            // Prepare and pass on. A failure is applied in order as a failure of the items.
+            pUnit->m_bPrepared = false;
+            try
+            {
+                if( pUnit->m_bColumnar )
+                    m_shpPreparation->PrepareColumns( pUnit->m_columns.View(), OUT pUnit->m_vecPrepared );  // void
+                else
+                    m_shpPreparation->PrepareBatch( pUnit->m_vecItems, OUT pUnit->m_vecPrepared );  // void
+                pUnit->m_bPrepared = true;
+            }
+            catch( const exception& ex )
+            {
+                IX_LOG( Error, "*** Exception " << ex.what() );
+            }
+            m_queueIndex.Push( pUnit );  // void
+
+        }  // end while
     }
 
-// IIXEnumerable
-public:
+    // Indexing stage.
+    void IndexStage()
+    {
+        // Index the units in sequence order until the queue is closed.
+        Unit* pUnit = nullptr;
+        size_t stNext = 0;
+        while( m_queueIndex.Pop( OUT pUnit ) )
+        {
+            // Park the unit in the reorder buffer. The window can never be exceeded
+            // since there are no more units than slots.
+            m_vecReorder[ pUnit->m_stSequence % m_stWindow ] = pUnit;
 
-    // Proceeds the enumerator.
-    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen ) override
+            // Apply all units which are next in order.
+            while( ( pUnit = m_vecReorder[ stNext % m_stWindow ] ) != nullptr && pUnit->m_stSequence == stNext )
+            {
+                m_vecReorder[ stNext % m_stWindow ] = nullptr;
+                Apply( *pUnit );  // void
+                stNext++;
+                if( pUnit->m_bCommit == false )
+                    m_queueFree.Push( pUnit );  // void
+                {
+                    lock_guard< mutex > lock( m_mutexIndexed );
+                    m_stIndexed = stNext;
+                }
+                m_cvIndexed.notify_all();  // void
+
+            }  // end while
+
+        }  // end while
+    }
+
+    // Applies a unit to the actual indexing engine.
+    void Apply( Unit& unit )
     {
-        // Initialize or proceed the enumerator. 
-        CIXAvailability retval( CIXAvailability::Available::No, ltLatestSeen );
-        if( m_bRetrieved == false )
+        // A commit reports to its caller. A failure of the items fails the next commit, so that the
+        // durable progress never passes items which were not indexed, or else is reported on the next call.
+        try
         {
-            // Retrieve the data as we have not done that yet.
-            retval = RetrieveData( ltLatestSeen );
+            if( unit.m_bCommit )
+                unit.m_bSuccess = m_bFailedSinceCommit == false && m_shpInner->Commit( unit.m_ltCommit, unit.m_iCommitCount );
+            else
+                unit.m_bSuccess = unit.m_bPrepared && m_shpInner->IndexPrepared( unit.m_vecPrepared );
         }
-        else if( m_itr != m_vecItems.end() )
+        catch( const exception& )
         {
-            // We have already attempted to retrieve some data.
-
-            // Proceed with the iterator.
-            m_itr++;
+            unit.m_bSuccess = false;
+        }
+        if( unit.m_bCommit && m_bFailedSinceCommit )
+        {
+            IX_LOG( Error, "*** Items failed to be indexed before the commit at ts( " << unit.m_ltCommit.Get() << " )." );
+            m_bFailedSinceCommit = false;
+            m_bFailed.store( false );  // void
+        }
+        else if( unit.m_bCommit == false && unit.m_bSuccess == false )
+        {
+            m_bFailedSinceCommit = true;
+            m_bFailed.store( true );  // void
 
-            // Determine the continuation status.
-            retval = m_itr != m_vecItems.end()
-                    ? CIXAvailability( CIXAvailability::Available::Yes, m_ltLatestKnown )
-                    : m_bExhausted
-                            ? CIXAvailability( CIXAvailability::Available::No, m_ltLatestKnown )
-                            : CIXAvailability( CIXAvailability::Available::Perhaps, m_ltLatestKnown );
         }  // end if
+    }
 
-        // Inspect the availability status.
-        switch( retval.AccessAvailability() )
-        {
-        case CIXAvailability::Available::Perhaps:
+private:
+    IIXIndexing::SHP m_shpInner;  // Actual indexing engine.
+    IIXDataPreparation::SHP m_shpPreparation;  // Data preparation.
+    vector< Unit > m_vecUnits;  // Work units.
+    CIXBlockingQueue< Unit* > m_queueFree;  // Free work units.
+    CIXBlockingQueue< Unit* > m_queuePrepare;  // Units waiting for preparation.
+    CIXBlockingQueue< Unit* > m_queueIndex;  // Units waiting for indexing.
+    vector< Unit* > m_vecReorder;  // Reorder buffer of the indexing stage.
+    size_t m_stWindow;  // Size of the reorder buffer.
+    atomic< size_t > m_stNextSequence;  // Next sequence number to assign.
+    mutex m_mutexIndexed;  // Protects the number of units applied.
+    condition_variable m_cvIndexed;  // Signals the applied units.
+    size_t m_stIndexed;  // Number of units applied.
+    vector< thread > m_vecWorkers;  // Preparation stage threads.
+    thread m_threadIndex;  // Indexing stage thread.
+    bool m_bFailedSinceCommit;  // Indicates a failure of the items since the latest commit, used by the indexing stage only.
+    atomic< bool > m_bFailed;  // Indicates an unreported failure of the items.
+};
 
-            // Debug output.
-            cout << Indent( 2 ) << "Perhaps more data available." << endl;
-            break;
+// Data retrieval interface.
+class IIXDataRetrieval
+{
+public:
 
-        case CIXAvailability::Available::No:
+    // Helper types.
+    typedef shared_ptr< IIXDataRetrieval > SHP;
 
-            // Debug output.
-            cout << Indent( 2 ) << "No more data available." << endl;
-            break;
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() = 0;
 
-        default:
-            break;
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) = 0;
 
-        }  // end switch
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    )
+    {
+        // Default to converting the rows. The row buffer is reused by the subsequent calls.
+        thread_local vector< CIXItem > vecItems;
+        CResult< CLogicalTimestamp > res = RetrieveData( ltLatestSeen, iCount, OUT bExhausted, OUT vecItems );
+        columns.Assign( vecItems );  // void
+        return res;
+    }
 
-        // Return value.
-        return CResult< CIXAvailability >( true, retval );
+    // Hints that the specified retrieval is likely to follow.
+    virtual void Prefetch( const CLogicalTimestamp&, int )
+    {
+        // No prefetching by default.
     }
 
-    // Gets the current item.
-    virtual CResult< CIXItem > Current() const override
+    // Waits until items later than the specified timestamp may be available, or the timeout passes.
+    // Returns false on timeout.
+    virtual bool WaitForData( const CLogicalTimestamp& ltLatestSeen, chrono::milliseconds msTimeout )
     {
-        // Do we have data available?
-        if( m_itr == m_vecItems.end() )
-        {
-            // No, raise an error.
-            return CResult< CIXItem >( false, CIXItem() );
-        }
-        else
+        // Without a notification from the source, check at intervals.
+        chrono::steady_clock::time_point tpDeadline = chrono::steady_clock::now() + msTimeout;
+        while( GetGloballyAvailable() <= ltLatestSeen.Get() )
         {
-            // Yes, use the iterator to return the data.
-            return CResult< CIXItem >( true, *m_itr );
+            chrono::steady_clock::time_point tpNow = chrono::steady_clock::now();
+            if( tpNow >= tpDeadline )
+                return false;
+            this_thread::sleep_for( std::min< chrono::steady_clock::duration >( tpDeadline - tpNow, chrono::milliseconds( 1 ) ) );  // void
 
-        }  // end if
+        }  // end while
+        return true;
     }
 
-    // Resets the enumerator.
-    virtual void Reset( IIXCallback::SHP shpCB ) override
+    // Destructor.
+    virtual ~IIXDataRetrieval()
     {
-        // Reset the members.
-        _ASSERTE( shpCB );
-        m_bRetrieved = false;
     }
+};
 
-private:
+// Helper class to encapsulate the data availability status during enumeration.
+class CIXAvailability
+{
+public:
 
-    // Delete the default constructor.
-    CIXItemsChunked() = delete;
+    // Availability status values.
+    enum class Available { Yes, Perhaps, No };
 
     // Constructor.
-    CIXItemsChunked( IIXCallback::SHP shpCB ) :
-        m_shpCB( shpCB ), m_bExhausted( false )
+    CIXAvailability( Available available, const CLogicalTimestamp& ltLatestKnown ) :
+        m_available( available ), m_ltLatestKnown( ltLatestKnown )
     {
-        // Delegate.
-        Reset( m_shpCB );
     }
 
-    // Attempts to retrieve data to the local container.
-    CIXAvailability RetrieveData( const CLogicalTimestamp& ltLatestSeen )
+    // Default constructor.
+    CIXAvailability() :
+        m_available( Available::No )
     {
-        // Use the data source if available.
-        _ASSERTE( m_shpCB );
-        m_ltLatestKnown = ltLatestSeen;
-        CIXAvailability retval( CIXAvailability::Available::No, m_ltLatestKnown );
-        IIXDataRetrieval::SHP shpDataRetrieval = m_shpCB->AccessDataRetrieval();
-        if( shpDataRetrieval )
-        {
-            // Retrieve the data and set the iterator.
-            m_ltLatestKnown = IX_TRY( shpDataRetrieval->RetrieveData( ltLatestSeen, m_shpCB->GetChunkSize(),
-                    OUT m_bExhausted, OUT m_vecItems ) );
-            m_itr = m_vecItems.begin();
-
-        }  // end if
-
-        // Initialization status.
-        m_bRetrieved = true;
+    }
 
-        // Continuation status.
-        if( m_ltLatestKnown.IsLaterThan( ltLatestSeen ) )
-        {
-            // Construct the availability result.
-            retval = CIXAvailability( 
-                    m_itr != m_vecItems.end()
-                            ? CIXAvailability::Available::Yes 
-                            : m_bExhausted
-                                    ? CIXAvailability::Available::No
-                                    : CIXAvailability::Available::Perhaps,
-                    m_ltLatestKnown );
-        }
+    // Accesses the availability status.
+    Available AccessAvailability() const { return m_available;  }
 
-        return retval;
-    }
+    // Accesses the latest known timestamp value.
+    const CLogicalTimestamp& AccessLatestKnownTimestamp() const { return m_ltLatestKnown; }
 
 private:
-    IIXCallback::SHP m_shpCB;  // Callback interface.
-    bool m_bRetrieved;  // Indicates whether the data has been retrieved.
+    Available m_available;  // Availability status.
     CLogicalTimestamp m_ltLatestKnown;  // Latest known timestamp.
-    bool m_bExhausted;  // Indicates whether the data source was exhausted.
-    vector< CIXItem > m_vecItems;  // Local container for items.
-    vector< CIXItem >::const_iterator m_itr;  // Local iterator for items.
 };
 
-// Enumerator object for batched item data.
-class CIXItemsBatched : public IIXEnumerable, public CLifeReporterAgent< CIXItemsBatched >
+// Data retrieval implementation.
+class CIXDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXDataRetrieval >
 {
 public:
 
-    // Factory method.
-    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    // Constructor.
+    CIXDataRetrieval()
+        : m_iAcceptanceThreshold( 0 )
     {
-        // Sanity check.
-        if( shpCB == nullptr )
-            return IIXEnumerable::UP();
+        // Seed the generator once. Asking the random device for every item may cost a system call each.
+        m_rng.seed( std::random_device()() );  // void
 
-        // Delegate.
-        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsBatched( shpCB ) ) );
+        // Define the random number range.
+        m_distr = std::uniform_int_distribution< int >( 1, 100 );
     }
 
     // Destructor.
-    virtual ~CIXItemsBatched()
+    virtual ~CIXDataRetrieval()
     {
     }
 
-// IIXEnumerable
+// IIXDataRetrieval
 public:
 
-    // Proceeds the enumerator.
-    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen_ ) override
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() override
     {
-        // Locals.
-        CResult< CIXAvailability > res( true, CIXAvailability() );
-        CIXAvailability availability;
-        CLogicalTimestamp ltLatestSeen = ltLatestSeen_;
-        bool bContinueWithNewerTimestamp = true;
+        return 81;
+    }
 
-        // Loop while lower layers do not return a definitive Yes/No answer.
-        while( bContinueWithNewerTimestamp )
-        {
-            // Reset the continuation flag.
-            bContinueWithNewerTimestamp = false;
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
+    {
+        // Fill the rows. A recycled buffer has the capacity already.
+        vecItems.clear();
+        vecItems.reserve( iCount );
+        return Generate( ltLatestSeen, iCount, OUT bExhausted,
+                [ &vecItems ]( int i, int j, int k, const CLogicalTimestamp& lt ) { vecItems.push_back( CIXItem( i, j, k, lt ) ); } );
+    }
 
-            // Proceed the enumerator.
-            res = m_upLowerLayerEnum->MoveNext( ltLatestSeen );
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    ) override
+    {
+        // Fill the columns directly.
+        columns.Clear();  // void
+        columns.Reserve( iCount );  // void
+        return Generate( ltLatestSeen, iCount, OUT bExhausted,
+                [ &columns ]( int i, int j, int k, const CLogicalTimestamp& lt ) { columns.Append( i, j, k, lt ); } );
+    }
 
-            // Track the return value.
-            availability = IX_TRY( res );
-            switch( availability.AccessAvailability() )
-            {
+private:
 
-            // Data available.
-            case CIXAvailability::Available::Yes:
+    // Generates the data and passes the accepted items to the specified function.
+    template< typename TAppend >
+    CResult< CLogicalTimestamp > Generate(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        TAppend append
+    )
+    {
+        // Reset out params.
+        bExhausted = false;
 
-                // Track the number of the received items.
-                m_iCurrentCount++;
-                break;
+        // Latest known timestamp after the initial threshold.
+        CLogicalTimestamp ltLatestKnown = ltLatestSeen;
 
-            // No data available.
-            case CIXAvailability::Available::No:
+        // Determine the timestamp threshold.
+        int iStart = ltLatestSeen.Get() + 1;
 
-                // Data source has been exhausted, so we need to commit the status.
-                // TODO: FastForward?
-                IX_TRY( Commit( ltLatestSeen ) );  // Return value ignored.
+        // Retrieve the data.
+        int iRetrieved = 0;
+        int iItem = 0;
+        for( iItem = iStart; iItem < iStart + iCount; iItem++ )
+        {
+            // Check the overall availability of data. The timestamps are addressed
+            // directly, so repeated retrievals of the same range are harmless.
+            if( iItem > GetGloballyAvailable() )
+            {
+                bExhausted = true;
                 break;
 
-            // Perhaps data available.
-            case CIXAvailability::Available::Perhaps:
+            }  // end if
 
-                // There might be more data available, but in order to determine that we 
-                // need to re-initialize the lower layers when we proceed the enumerator
-                // next time. Before doing that, we must commit the current status if we
-                // have received more items than the batch size.
-                if( IsIntermediateCommitNeeded() )
-                {
-                    // Commit the current status.
-                    IX_TRY( Commit( ltLatestSeen ) );  // Return value ignored.
-                }
-                else
-                {
-                    // Sanity check.
-                    //***if( availability.AccessLatestKnownTimestamp().IsLaterThan( ltLatestSeen ) == false )
-                    //***    return CResult< CIXAvailability >( false, res.AccessRetVal() );
+            // Store the data.
+            ltLatestKnown = CLogicalTimestamp( iItem );
+            if( m_distr( m_rng ) > m_iAcceptanceThreshold )
+            {
+                append( iItem * 2, iItem * 3, iItem * 4, ltLatestKnown );  // void
+                iRetrieved++;
 
-                    // Forward the timestamp.
-                    m_shpCB->UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+            }  // end if
 
-                    // Reset the lower layers.
-                    Reset( m_shpCB );  // void
+        }  // end for
 
-                    // Use the updated timestamp.
-                    ltLatestSeen = m_shpCB->AccessLatestSeen();
+        // Debug output.
+        IX_LOG( Debug, Indent( 2 ) <<
+                "Retrieved " <<
+                iRetrieved <<
+                " items. Latest known timestamp is " <<
+                ltLatestKnown.Get() <<
+                "." );
 
-                    // Indicate that the loop should continue.
-                    bContinueWithNewerTimestamp = true;
+        return CResult< CLogicalTimestamp >( true, ltLatestKnown );
+    }
 
-                }  // end if
+private:
+    std::minstd_rand m_rng;  // Random number generator, seeded from hardware.
+	std::uniform_int_distribution< int > m_distr;  // Define the range.
+    int m_iAcceptanceThreshold;  // Acceptance threshold.
+};
 
-                break;
+// Shape of a synthetic workload.
+class CIXWorkloadSpec
+{
+public:
 
-            default:
-                break;
+    // Constructor.
+    CIXWorkloadSpec()
+        : m_iItems( 0 ), m_uSeed( 1 ), m_dAcceptance( 1.0 ), m_dGaps( 0.0 ), m_dBursts( 0.0 ),
+          m_iSegmentLength( 256 ), m_usChunkLatency( 0 ), m_iPayloadBytes( 0 )
+    {
+    }
 
-            }  // end switch
+public:
+    int m_iItems;  // Number of timestamps, or zero for no synthetic workload.
+    uint64_t m_uSeed;  // Seed. The same seed produces the same items.
+    double m_dAcceptance;  // Portion of the timestamps with an item, outside the gaps and the bursts.
+    double m_dGaps;  // Portion of the segments without any items.
+    double m_dBursts;  // Portion of the segments with an item at every timestamp.
+    int m_iSegmentLength;  // Timestamps per segment.
+    chrono::microseconds m_usChunkLatency;  // Latency injected into each retrieval.
+    int m_iPayloadBytes;  // Payload generated for each item and folded into its data.
+};
 
-        }  // end while
+// Data retrieval producing a seeded synthetic workload. Every item is a pure function of the seed
+// and its timestamp, computed by a counter-based generator, so that the items can be retrieved in
+// any order and any number of times, e.g. by the shards or after a rewind, and the runs with the
+// same seed are identical. The timestamps are split into segments, each of which is either a gap,
+// a burst, or a run of items at the accepted timestamps.
+class CIXWorkloadDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXWorkloadDataRetrieval >
+{
+public:
 
-        return res;
+    // Constructor.
+    CIXWorkloadDataRetrieval( const CIXWorkloadSpec& spec )
+        : m_spec( spec )
+    {
+        // Thresholds of the 64-bit hashes.
+        m_spec.m_iSegmentLength = std::max( 1, m_spec.m_iSegmentLength );
+        m_uAcceptance = ToThreshold( m_spec.m_dAcceptance );
+        m_uGaps = ToThreshold( m_spec.m_dGaps );
+        m_uGapsAndBursts = ToThreshold( m_spec.m_dGaps + m_spec.m_dBursts );
     }
 
-    // Gets the current item.
-    virtual CResult< CIXItem > Current() const override
+    // Destructor.
+    virtual ~CIXWorkloadDataRetrieval()
     {
-        // Delegate to the lower layer.
-        return m_upLowerLayerEnum->Current();
     }
 
-    // Resets the enumerator.
-    virtual void Reset( IIXCallback::SHP shpCB ) override
+// IIXDataRetrieval
+public:
+
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() override
     {
-        // Create the lower enumerator layer.
-        cout << Indent( 1 ) << "Chunk being initialized." << endl;
-        m_upLowerLayerEnum = IX_UP_TRY( CIXItemsChunked::Create( shpCB ) );
-        m_iChunks++;
+        return m_spec.m_iItems;
     }
 
-private:
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
+    {
+        // Fill the rows. A recycled buffer has the capacity already.
+        vecItems.clear();
+        vecItems.reserve( iCount );
+        return Generate( ltLatestSeen, iCount, OUT bExhausted,
+                [ &vecItems ]( int i, int j, int k, const CLogicalTimestamp& lt ) { vecItems.push_back( CIXItem( i, j, k, lt ) ); } );
+    }
 
-    // Delete the default constructor.
-    CIXItemsBatched() = delete;
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    ) override
+    {
+        // Fill the columns directly.
+        columns.Clear();  // void
+        columns.Reserve( iCount );  // void
+        return Generate( ltLatestSeen, iCount, OUT bExhausted,
+                [ &columns ]( int i, int j, int k, const CLogicalTimestamp& lt ) { columns.Append( i, j, k, lt ); } );
+    }
 
-    // Constructor.
-    CIXItemsBatched( IIXCallback::SHP shpCB ) :
-        m_shpCB( shpCB ), m_iCurrentCount( 0 ), m_iChunks( 0 )
+private:
+
+    // Generates the items of the timestamp range and passes them to the specified function.
+    template< typename TAppend >
+    CResult< CLogicalTimestamp > Generate(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        TAppend append
+    )
     {
-        // Delegate.
-        Reset( m_shpCB );  // void
+        // Simulate the latency of the source.
+        if( m_spec.m_usChunkLatency.count() > 0 )
+            this_thread::sleep_for( m_spec.m_usChunkLatency );  // void
+
+        // The range ends at the end of the workload.
+        int64_t iStart = static_cast< int64_t >( ltLatestSeen.Get() ) + 1;
+        int64_t iEnd = std::min( iStart + std::max( 0, iCount ), static_cast< int64_t >( m_spec.m_iItems ) + 1 );
+        bExhausted = iEnd > m_spec.m_iItems;
+
+        // Generate the items at the accepted timestamps.
+        int iRetrieved = 0;
+        for( int64_t iItem = iStart; iItem < iEnd; iItem++ )
+        {
+            uint64_t uHash = Hash( static_cast< uint64_t >( iItem ) );
+            if( IsAccepted( iItem, uHash ) == false )
+                continue;
+            uint64_t uData = Mix( uHash ) ^ GeneratePayload( uHash );
+            append( static_cast< int >( uData % 1000 ), static_cast< int >( ( uData >> 20 ) % 1000 ),
+                    static_cast< int >( ( uData >> 40 ) % 1000 ), CLogicalTimestamp( static_cast< int >( iItem ) ) );  // void
+            iRetrieved++;
+
+        }  // end for
+
+        // Debug output.
+        CLogicalTimestamp ltLatestKnown( static_cast< int >( std::max( iStart, iEnd ) - 1 ) );
+        IX_LOG( Debug, Indent( 2 ) <<
+                "Retrieved " <<
+                iRetrieved <<
+                " items. Latest known timestamp is " <<
+                ltLatestKnown.Get() <<
+                "." );
+
+        return CResult< CLogicalTimestamp >( true, ltLatestKnown );
     }
 
-    // Commits the current progress.
-    CResult< bool > Commit( const CLogicalTimestamp& lt )
+    // Indicates whether the timestamp has an item.
+    bool IsAccepted( int64_t iItem, uint64_t uHash ) const
     {
-        // Try to commit.
-        _ASSERTE( m_shpCB );
-        bool bSuccess = false;
-        IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
-        if( shpIndexing )
-            bSuccess = shpIndexing->Commit( lt, m_iCurrentCount );
+        // The segment decides first.
+        uint64_t uSegment = Hash( ~static_cast< uint64_t >( ( iItem - 1 ) / m_spec.m_iSegmentLength ) );
+        if( uSegment < m_uGaps )
+            return false;
+        if( uSegment < m_uGapsAndBursts )
+            return true;
+        return uHash < m_uAcceptance || m_spec.m_dAcceptance >= 1.0;
+    }
 
-        // Reset the counter for batch content.
-        m_iCurrentCount = 0;
+    // Generates the payload of an item into the scratch buffer and returns its digest.
+    uint64_t GeneratePayload( uint64_t uHash )
+    {
+        // Fill the buffer word by word.
+        if( m_spec.m_iPayloadBytes <= 0 )
+            return 0;
+        m_vecPayload.resize( ( static_cast< size_t >( m_spec.m_iPayloadBytes ) + 7 ) / 8 );  // void
+        uint64_t uDigest = 0;
+        for( uint64_t& uWord : m_vecPayload )
+        {
+            uHash = Mix( uHash );
+            uWord = uHash;
+            uDigest = ( uDigest ^ uWord ) * 0x100000001b3ULL;
 
-        // Return value.
-        return CResult< bool >( true, bSuccess );
+        }  // end for
+        return uDigest;
     }
 
-    // Is intermediate commit needed?
-    bool IsIntermediateCommitNeeded()
+    // Hashes the value with the seed.
+    uint64_t Hash( uint64_t uValue ) const
     {
-        // Is the batch full?
-        bool bBatchFull =
-                m_iCurrentCount > 0 && m_iCurrentCount >= m_shpCB->GetBatchSize();
+        return Mix( m_spec.m_uSeed ^ Mix( uValue ) );
+    }
 
-        // Do the chunks equal to a batch (even though we haven't seen them all)?
-        bool bChunksEqualToBatch =
-                m_iChunks * m_shpCB->GetChunkSize() >= m_shpCB->GetBatchSize();
+    // Mixes the bits of the value, as the finalizer of SplitMix64.
+    static uint64_t Mix( uint64_t uValue )
+    {
+        uValue += 0x9e3779b97f4a7c15ULL;
+        uValue = ( uValue ^ ( uValue >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+        uValue = ( uValue ^ ( uValue >> 27 ) ) * 0x94d049bb133111ebULL;
+        return uValue ^ ( uValue >> 31 );
+    }
 
-        return bBatchFull || bChunksEqualToBatch;
+    // Converts a portion to the threshold of the 64-bit hashes.
+    static uint64_t ToThreshold( double dPortion )
+    {
+        // Clamp.
+        if( dPortion <= 0.0 )
+            return 0;
+        if( dPortion >= 1.0 )
+            return UINT64_MAX;
+        return static_cast< uint64_t >( dPortion * 18446744073709551616.0 );
     }
 
 private:
-    IIXCallback::SHP m_shpCB;  // Callback interface.
-    IIXEnumerable::UP m_upLowerLayerEnum;  // The lower layer enumerator.
-    int m_iChunks;  // The number of chunks used.
-    int m_iCurrentCount;  // The number of the processed items.
+    CIXWorkloadSpec m_spec;  // Shape of the workload.
+    uint64_t m_uAcceptance;  // Hashes below this have an item.
+    uint64_t m_uGaps;  // Segment hashes below this are gaps.
+    uint64_t m_uGapsAndBursts;  // Segment hashes below this and not gaps are bursts.
+    vector< uint64_t > m_vecPayload;  // Scratch buffer for the payload.
 };
 
-// Top level enumerator object.
-class CIXItemsEnumerator : public IIXEnumerable, public CLifeReporterAgent< CIXItemsEnumerator >
+// Data retrieval decorator that retrieves the next chunk in the background.
+class CIXPrefetchingDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXPrefetchingDataRetrieval >
 {
 public:
 
-    // Factory method.
-    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    // Constructor.
+    CIXPrefetchingDataRetrieval( IIXDataRetrieval::SHP shpInner )
+        : m_shpInner( shpInner ), m_state( State::Idle ), m_bStop( false ),
+          m_iCount( 0 ), m_bColumnar( false ), m_bLastColumnar( false ), m_bExhausted( false )
     {
-        // Sanity check.
-        if( shpCB == nullptr )
-            return IIXEnumerable::UP();
-
-        // Delegate.
-        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsEnumerator( shpCB ) ) );
+        // Start the background thread.
+        _ASSERTE( m_shpInner );
+        m_thread = thread( &CIXPrefetchingDataRetrieval::Worker, this );
     }
 
     // Destructor.
-    virtual ~CIXItemsEnumerator()
+    virtual ~CIXPrefetchingDataRetrieval()
     {
+        // Stop the background thread. A retrieval in progress is completed first.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
     }
 
-// IIXEnumerable
+// IIXDataRetrieval
 public:
 
-    // Proceeds the enumerator.
-    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen_ ) override
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() override
     {
-        // Locals.
-        CResult< CIXAvailability > res( true, CIXAvailability() );
-        CIXAvailability availability;
-        CLogicalTimestamp ltLatestSeen = ltLatestSeen_;
-        bool bContinueWithNewerTimestamp = true;
+        // Delegate.
+        return m_shpInner->GetGloballyAvailable();
+    }
 
-        // Loop while lower layers do not return a definitive Yes/No answer.
-        while( bContinueWithNewerTimestamp )
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
+    {
         {
-            // Reset the continuation flag.
-            bContinueWithNewerTimestamp = false;
+            // Use the prefetched data if it matches the request. Otherwise it is stale and dropped.
+            unique_lock< mutex > lock( m_mutex );
+            if( IsReady( lock, ltLatestSeen, iCount, false ) )
+            {
+                // Swap the buffers so that the caller's buffer is reused by the next prefetch.
+                bExhausted = m_bExhausted;
+                vecItems.swap( m_vecItems );
+                return m_res;
+
+            }  // end if
+        }
+
+        // Retrieve synchronously. The background thread is idle now.
+        return m_shpInner->RetrieveData( ltLatestSeen, iCount, OUT bExhausted, OUT vecItems );
+    }
+
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    ) override
+    {
+        {
+            // Use the prefetched data if it matches the request. Otherwise it is stale and dropped.
+            unique_lock< mutex > lock( m_mutex );
+            if( IsReady( lock, ltLatestSeen, iCount, true ) )
+            {
+                // Swap the buffers so that the caller's buffer is reused by the next prefetch.
+                bExhausted = m_bExhausted;
+                swap( columns, m_columns );  // void
+                return m_res;
+
+            }  // end if
+        }
+
+        // Retrieve synchronously, keeping the columns of the inner retrieval.
+        return m_shpInner->RetrieveColumns( ltLatestSeen, iCount, OUT bExhausted, OUT columns );
+    }
+
+    // Hints that the specified retrieval is likely to follow.
+    virtual void Prefetch( const CLogicalTimestamp& ltLatestSeen, int iCount ) override
+    {
+        {
+            // Drop the previous prefetch which was never claimed.
+            unique_lock< mutex > lock( m_mutex );
+            m_cv.wait( lock, [ this ] { return m_state != State::Requested; } );
+
+            // Request the retrieval in the layout of the previous one.
+            m_ltLatestSeen = ltLatestSeen;
+            m_iCount = iCount;
+            m_bColumnar = m_bLastColumnar;
+            m_state = State::Requested;
+        }
+        m_cv.notify_all();
+    }
+
+    // Waits until items later than the specified timestamp may be available, or the timeout passes.
+    virtual bool WaitForData( const CLogicalTimestamp& ltLatestSeen, chrono::milliseconds msTimeout ) override
+    {
+        // Delegate.
+        return m_shpInner->WaitForData( ltLatestSeen, msTimeout );
+    }
+
+private:
+
+    // Prefetch states.
+    enum class State { Idle, Requested, Ready };
+
+    // Waits for the prefetch in progress, if any, and claims the prefetched data if it matches the request.
+    bool IsReady( unique_lock< mutex >& lock, const CLogicalTimestamp& ltLatestSeen, int iCount, bool bColumnar )
+    {
+        // Wait.
+        m_cv.wait( lock, [ this ] { return m_state != State::Requested; } );
+        m_bLastColumnar = bColumnar;
+        if( m_state != State::Ready )
+            return false;
+
+        // Claim.
+        m_state = State::Idle;
+        return m_ltLatestSeen.Get() == ltLatestSeen.Get() && m_iCount == iCount && m_bColumnar == bColumnar;
+    }
+
+    // Background thread.
+    void Worker()
+    {
+        // Serve the requests until stopped.
+        unique_lock< mutex > lock( m_mutex );
+        while( true )
+        {
+            // Wait for a request.
+            m_cv.wait( lock, [ this ] { return m_bStop || m_state == State::Requested; } );
+            if( m_bStop )
+                break;
+
+            // Retrieve without holding the lock. The members are not touched by others meanwhile.
+            lock.unlock();
+            bool bExhausted = false;
+            CResult< CLogicalTimestamp > res = m_bColumnar
+                    ? m_shpInner->RetrieveColumns( m_ltLatestSeen, m_iCount, OUT bExhausted, OUT m_columns )
+                    : m_shpInner->RetrieveData( m_ltLatestSeen, m_iCount, OUT bExhausted, OUT m_vecItems );
+            lock.lock();
+
+            // Publish the result.
+            m_res = res;
+            m_bExhausted = bExhausted;
+            m_state = State::Ready;
+            m_cv.notify_all();
+
+        }  // end while
+    }
+
+private:
+    IIXDataRetrieval::SHP m_shpInner;  // Actual data retrieval.
+    mutex m_mutex;  // Guards the prefetch state.
+    condition_variable m_cv;  // Signals prefetch state changes.
+    thread m_thread;  // Background thread.
+    State m_state;  // Prefetch state.
+    bool m_bStop;  // Indicates whether the background thread should stop.
+    CLogicalTimestamp m_ltLatestSeen;  // Prefetched starting point.
+    int m_iCount;  // Prefetched count.
+    bool m_bColumnar;  // Indicates whether the prefetched items are held column by column.
+    bool m_bLastColumnar;  // Indicates whether the latest retrieval was column by column.
+    CResult< CLogicalTimestamp > m_res;  // Prefetched result.
+    bool m_bExhausted;  // Prefetched exhaustion status.
+    vector< CIXItem > m_vecItems;  // Prefetched items.
+    CIXItemColumns m_columns;  // Prefetched items, held column by column.
+};
+
+// Data retrieval decorator limited to a timestamp range, so that the range can be crawled
+// independently of the others. The range starts after the timestamp the crawl starts from and
+// ends at the specified timestamp, inclusive.
+class CIXRangeDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXRangeDataRetrieval >
+{
+public:
+
+    // Constructor.
+    CIXRangeDataRetrieval( IIXDataRetrieval::SHP shpInner, const CLogicalTimestamp& ltTo )
+        : m_shpInner( shpInner ), m_ltTo( ltTo )
+    {
+        _ASSERTE( m_shpInner );
+    }
+
+    // Destructor.
+    virtual ~CIXRangeDataRetrieval()
+    {
+    }
+
+// IIXDataRetrieval
+public:
+
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() override
+    {
+        // Nothing beyond the range.
+        return std::min( m_shpInner->GetGloballyAvailable(), m_ltTo.Get() );
+    }
+
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
+    {
+        // Stop at the end of the range.
+        int iRemaining = GetRemaining( ltLatestSeen, iCount );
+        if( iRemaining == 0 )
+        {
+            vecItems.clear();
+            bExhausted = true;
+            return CResult< CLogicalTimestamp >( true, ltLatestSeen );
+
+        }  // end if
+        CResult< CLogicalTimestamp > res = m_shpInner->RetrieveData( ltLatestSeen, iRemaining, OUT bExhausted, OUT vecItems );
+
+        // Drop the items beyond the range, which a source with gaps in the timestamps may return.
+        while( vecItems.empty() == false && vecItems.back().AccessLT().IsLaterThan( m_ltTo ) )
+            vecItems.pop_back();  // void
+        return Limit( res, OUT bExhausted );
+    }
+
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    ) override
+    {
+        // Stop at the end of the range.
+        int iRemaining = GetRemaining( ltLatestSeen, iCount );
+        if( iRemaining == 0 )
+        {
+            columns.Clear();  // void
+            bExhausted = true;
+            return CResult< CLogicalTimestamp >( true, ltLatestSeen );
+
+        }  // end if
+        CResult< CLogicalTimestamp > res = m_shpInner->RetrieveColumns( ltLatestSeen, iRemaining, OUT bExhausted, OUT columns );
+
+        // Drop the items beyond the range, which a source with gaps in the timestamps may return.
+        const int* piTimestamps = columns.View().AccessTimestamps();
+        columns.Truncate( static_cast< size_t >( upper_bound( piTimestamps, piTimestamps + columns.GetSize(), m_ltTo.Get() ) - piTimestamps ) );  // void
+        return Limit( res, OUT bExhausted );
+    }
+
+    // Hints that the specified retrieval is likely to follow.
+    virtual void Prefetch( const CLogicalTimestamp& ltLatestSeen, int iCount ) override
+    {
+        // Limit the hint the same way as the retrieval, so that they match.
+        int iRemaining = GetRemaining( ltLatestSeen, iCount );
+        if( iRemaining > 0 )
+            m_shpInner->Prefetch( ltLatestSeen, iRemaining );  // void
+    }
+
+    // Waits until items later than the specified timestamp may be available, or the timeout passes.
+    virtual bool WaitForData( const CLogicalTimestamp& ltLatestSeen, chrono::milliseconds msTimeout ) override
+    {
+        // Nothing to wait for at the end of the range.
+        return GetRemaining( ltLatestSeen, 1 ) > 0 && m_shpInner->WaitForData( ltLatestSeen, msTimeout );
+    }
+
+private:
+
+    // Returns the number of items to request within the range.
+    int GetRemaining( const CLogicalTimestamp& ltLatestSeen, int iCount ) const
+    {
+        return std::max( 0, std::min( iCount, m_ltTo.Get() - ltLatestSeen.Get() ) );
+    }
+
+    // Marks the range exhausted once the retrieval reaches its end, which is then the latest known timestamp.
+    CResult< CLogicalTimestamp > Limit( const CResult< CLogicalTimestamp >& res, IN OUT bool& bExhausted ) const
+    {
+        if( res.Success() && res.AccessRetVal().Get() >= m_ltTo.Get() )
+        {
+            bExhausted = true;
+            return CResult< CLogicalTimestamp >( true, m_ltTo );
+
+        }  // end if
+        return res;
+    }
+
+private:
+    IIXDataRetrieval::SHP m_shpInner;  // Actual data retrieval.
+    CLogicalTimestamp m_ltTo;  // End of the range, inclusive.
+};
+
+// Memory-mapped file.
+class CIXMappedFile
+{
+public:
+
+    // Constructor.
+    CIXMappedFile()
+        : m_pData( nullptr ), m_stSize( 0 ),
+#ifdef _WIN32
+          m_hFile( INVALID_HANDLE_VALUE ), m_hMapping( NULL )
+#else
+          m_iFile( -1 )
+#endif
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXMappedFile()
+    {
+        // Delegate.
+        Close();  // void
+    }
+
+    // Maps the specified file. A writable file is created or extended to at least the given size,
+    // whereas zero maps a read-only file as it is.
+    bool Open( const string& szPath, size_t stSize, bool bWritable )
+    {
+        // Start from scratch.
+        Close();  // void
+
+#ifdef _WIN32
+        // Open the file.
+        m_hFile = CreateFileA( szPath.c_str(), bWritable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, bWritable ? OPEN_ALWAYS : OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, NULL );
+        if( m_hFile == INVALID_HANDLE_VALUE )
+            return false;
+
+        // Determine the size.
+        LARGE_INTEGER liSize = {};
+        if( GetFileSizeEx( m_hFile, &liSize ) == FALSE )
+            return Fail();
+        m_stSize = std::max( static_cast< size_t >( liSize.QuadPart ), bWritable ? stSize : 0 );
+        if( m_stSize == 0 )
+            return Fail();
+
+        // Map the file. The mapping extends a writable file as necessary.
+        LARGE_INTEGER liMapped = {};
+        liMapped.QuadPart = static_cast< LONGLONG >( m_stSize );
+        m_hMapping = CreateFileMappingA( m_hFile, NULL, bWritable ? PAGE_READWRITE : PAGE_READONLY,
+                liMapped.HighPart, liMapped.LowPart, NULL );
+        if( m_hMapping == NULL )
+            return Fail();
+        m_pData = static_cast< char* >( MapViewOfFile( m_hMapping, bWritable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_stSize ) );
+        if( m_pData == nullptr )
+            return Fail();
+#else
+        // Open the file.
+        m_iFile = open( szPath.c_str(), bWritable ? O_RDWR | O_CREAT : O_RDONLY, 0644 );
+        if( m_iFile < 0 )
+            return false;
+
+        // Determine the size and extend if necessary.
+        struct stat st = {};
+        if( fstat( m_iFile, &st ) != 0 )
+            return Fail();
+        m_stSize = static_cast< size_t >( st.st_size );
+        if( bWritable && m_stSize < stSize )
+        {
+            if( ftruncate( m_iFile, static_cast< off_t >( stSize ) ) != 0 )
+                return Fail();
+            m_stSize = stSize;
+
+        }  // end if
+        if( m_stSize == 0 )
+            return Fail();
+
+        // Map the file.
+        void* pData = mmap( nullptr, m_stSize, bWritable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_iFile, 0 );
+        if( pData == MAP_FAILED )
+            return Fail();
+        m_pData = static_cast< char* >( pData );
+#endif
+        return true;
+    }
+
+    // Unmaps the file.
+    void Close()
+    {
+#ifdef _WIN32
+        if( m_pData != nullptr )
+            UnmapViewOfFile( m_pData );
+        if( m_hMapping != NULL )
+            CloseHandle( m_hMapping );
+        if( m_hFile != INVALID_HANDLE_VALUE )
+            CloseHandle( m_hFile );
+        m_hMapping = NULL;
+        m_hFile = INVALID_HANDLE_VALUE;
+#else
+        if( m_pData != nullptr )
+            munmap( m_pData, m_stSize );
+        if( m_iFile >= 0 )
+            close( m_iFile );
+        m_iFile = -1;
+#endif
+        m_pData = nullptr;
+        m_stSize = 0;
+    }
+
+    // Writes the specified range durably to the disk.
+    bool Flush( size_t stOffset, size_t stLength )
+    {
+        // Sanity check.
+        if( m_pData == nullptr || stOffset + stLength > m_stSize )
+            return false;
+
+#ifdef _WIN32
+        return FlushViewOfFile( m_pData + stOffset, stLength ) != FALSE && FlushFileBuffers( m_hFile ) != FALSE;
+#else
+        // The range must start at a page boundary.
+        size_t stPage = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+        size_t stStart = stOffset - stOffset % stPage;
+        return msync( m_pData + stStart, stOffset + stLength - stStart, MS_SYNC ) == 0;
+#endif
+    }
+
+    // Accesses the mapped data.
+    char* AccessData() const { return m_pData; }
+
+    // Gets the mapped size.
+    size_t GetSize() const { return m_stSize; }
+
+    // Writes the entries of the specified directory durably to the disk, e.g. after a rename.
+    static bool FlushDirectory( const string& szDirectory )
+    {
+#ifdef _WIN32
+        // The file system journals the renames.
+        return true;
+#else
+        int iDirectory = open( szDirectory.c_str(), O_RDONLY | O_DIRECTORY );
+        if( iDirectory < 0 )
+            return false;
+        bool bSuccess = fsync( iDirectory ) == 0;
+        close( iDirectory );  // Return value ignored.
+        return bSuccess;
+#endif
+    }
+
+private:
+
+    // Disallow copying.
+    CIXMappedFile( const CIXMappedFile& ) = delete;
+    CIXMappedFile& operator=( const CIXMappedFile& ) = delete;
+
+    // Cleans up after a failure.
+    bool Fail()
+    {
+        Close();  // void
+        return false;
+    }
+
+private:
+    char* m_pData;  // Mapped data.
+    size_t m_stSize;  // Mapped size.
+#ifdef _WIN32
+    HANDLE m_hFile;  // File handle.
+    HANDLE m_hMapping;  // Mapping handle.
+#else
+    int m_iFile;  // File descriptor.
+#endif
+};
+
+// Helpers for checksums.
+namespace
+{
+    // Computes a CRC-32 checksum.
+    uint32_t IXCrc32( const void* pData, size_t stLength, uint32_t uCrc = 0 )
+    {
+        // Bitwise, as the amounts are small.
+        const unsigned char* pby = static_cast< const unsigned char* >( pData );
+        uCrc = ~uCrc;
+        for( size_t st = 0; st < stLength; st++ )
+        {
+            uCrc ^= pby[ st ];
+            for( int iBit = 0; iBit < 8; iBit++ )
+                uCrc = ( uCrc >> 1 ) ^ ( 0xEDB88320u & ( 0u - ( uCrc & 1u ) ) );
+
+        }  // end for
+        return ~uCrc;
+    }
+}
+
+// Helpers for waiting on a word of a mapped file, also across processes.
+namespace
+{
+    // Waits until the word is signaled, if it still has the expected value, or the timeout passes.
+    // May return spuriously.
+    void IXWaitOnWord( uint32_t* pu, uint32_t uExpected, chrono::nanoseconds nsTimeout )
+    {
+#ifdef __linux__
+        // A shared futex on the mapped page.
+        timespec ts = {};
+        ts.tv_sec = static_cast< time_t >( nsTimeout.count() / 1000000000 );
+        ts.tv_nsec = static_cast< long >( nsTimeout.count() % 1000000000 );
+        syscall( SYS_futex, pu, FUTEX_WAIT, uExpected, &ts, nullptr, 0 );  // Return value ignored.
+#else
+        // Elsewhere, check at intervals.
+        if( atomic_ref< uint32_t >( *pu ).load( memory_order_acquire ) == uExpected )
+            this_thread::sleep_for( std::min< chrono::nanoseconds >( nsTimeout, chrono::milliseconds( 1 ) ) );  // void
+#endif
+    }
+
+    // Wakes all waiting on the word.
+    void IXWakeOnWord( uint32_t* pu )
+    {
+#ifdef __linux__
+        syscall( SYS_futex, pu, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0 );  // Return value ignored.
+#endif
+    }
+}
+
+// Timestamp manager interface.
+class IIXTimestampManager
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXTimestampManager > SHP;
+
+    // Persists the committed timestamp.
+    virtual bool Commit( const CLogicalTimestamp& lt ) = 0;
+
+    // Gets the latest committed timestamp.
+    virtual CLogicalTimestamp GetLatestCommitted() const = 0;
+
+    // Destructor.
+    virtual ~IIXTimestampManager()
+    {
+    }
+};
+
+// Timestamp manager keeping a journal in a memory-mapped file. The journal is a ring of
+// checksummed records and the header points to the latest one, so reading it back takes
+// a constant time regardless of the history.
+class CIXTimestampManager : public IIXTimestampManager, public CLifeReporterAgent< CIXTimestampManager >
+{
+public:
+
+    // Factory method.
+    static IIXTimestampManager::SHP Create( const string& szPath, uint32_t uCapacity = 4096 )
+    {
+        // Map and validate the journal.
+        shared_ptr< CIXTimestampManager > shp( new CIXTimestampManager() );
+        if( shp->Open( szPath, uCapacity ) == false )
+            return IIXTimestampManager::SHP();
+        return shp;
+    }
+
+    // Destructor.
+    virtual ~CIXTimestampManager()
+    {
+    }
+
+// IIXTimestampManager
+public:
+
+    // Persists the committed timestamp.
+    virtual bool Commit( const CLogicalTimestamp& lt ) override
+    {
+        // Write the record first.
+        Header* pHeader = AccessHeader();
+        uint64_t ullSequence = m_ullLatest + 1;
+        size_t stSlot = static_cast< size_t >( ullSequence % pHeader->m_uCapacity );
+        Record* pRecord = AccessRecord( stSlot );
+        pRecord->m_ullSequence = ullSequence;
+        pRecord->m_iTimestamp = lt.Get();
+        pRecord->m_uChecksum = Checksum( *pRecord );
+        if( m_file.Flush( reinterpret_cast< char* >( pRecord ) - m_file.AccessData(), sizeof( Record ) ) == false )
+            return false;
+
+        // Then point the header to it. A crash in between leaves the record just after the one pointed to.
+        pHeader->m_ullLatest = ullSequence;
+        if( m_file.Flush( 0, sizeof( Header ) ) == false )
+            return false;
+
+        // Track.
+        m_ullLatest = ullSequence;
+        m_ltLatest = lt;
+        return true;
+    }
+
+    // Gets the latest committed timestamp.
+    virtual CLogicalTimestamp GetLatestCommitted() const override
+    {
+        return m_ltLatest;
+    }
+
+private:
+
+    // Journal header.
+    struct Header
+    {
+        uint32_t m_uMagic;  // File identification.
+        uint32_t m_uCapacity;  // Number of record slots.
+        uint64_t m_ullLatest;  // Sequence number of the latest record.
+    };
+
+    // Journal record.
+    struct Record
+    {
+        uint64_t m_ullSequence;  // Sequence number, starting from one.
+        int32_t m_iTimestamp;  // Committed timestamp.
+        uint32_t m_uChecksum;  // Checksum of the above.
+    };
+
+    // Constants.
+    static const uint32_t c_uMagic = 0x4A545849;  // "IXTJ"
+    static const size_t c_stHeaderSize = 64;
+
+    // Constructor.
+    CIXTimestampManager()
+        : m_ullLatest( 0 )
+    {
+    }
+
+    // Maps the journal and reads the latest record.
+    bool Open( const string& szPath, uint32_t uCapacity )
+    {
+        // Map the file, creating it if necessary.
+        if( uCapacity == 0 || m_file.Open( szPath, c_stHeaderSize + uCapacity * sizeof( Record ), true ) == false )
+            return false;
+
+        // Initialize a new journal.
+        Header* pHeader = AccessHeader();
+        if( pHeader->m_uMagic == 0 && pHeader->m_uCapacity == 0 )
+        {
+            pHeader->m_uCapacity = uCapacity;
+            pHeader->m_ullLatest = 0;
+            pHeader->m_uMagic = c_uMagic;
+            return m_file.Flush( 0, sizeof( Header ) );
+
+        }  // end if
+
+        // Validate an existing one.
+        if( pHeader->m_uMagic != c_uMagic || pHeader->m_uCapacity == 0 ||
+                m_file.GetSize() < c_stHeaderSize + pHeader->m_uCapacity * sizeof( Record ) )
+            return false;
+
+        // The latest record is either the one pointed to or the one following it.
+        uint64_t ullHint = pHeader->m_ullLatest;
+        if( TryRecord( ullHint + 1 ) == false && ullHint > 0 && TryRecord( ullHint ) == false )
+        {
+            // The header is corrupt, so look through all the records.
+            for( uint32_t uSlot = 0; uSlot < pHeader->m_uCapacity; uSlot++ )
+            {
+                const Record* pRecord = AccessRecord( uSlot );
+                if( IsValid( *pRecord ) && pRecord->m_ullSequence > m_ullLatest )
+                    TryRecord( pRecord->m_ullSequence );  // Return value ignored.
+
+            }  // end for
+
+        }  // end if
+
+        return true;
+    }
+
+    // Takes the record with the specified sequence number as the latest one if it is valid.
+    bool TryRecord( uint64_t ullSequence )
+    {
+        // Check the record.
+        const Record* pRecord = AccessRecord( static_cast< size_t >( ullSequence % AccessHeader()->m_uCapacity ) );
+        if( pRecord->m_ullSequence != ullSequence || IsValid( *pRecord ) == false )
+            return false;
+
+        // Track.
+        m_ullLatest = ullSequence;
+        m_ltLatest = CLogicalTimestamp( pRecord->m_iTimestamp );
+        return true;
+    }
+
+    // Computes the checksum of a record.
+    static uint32_t Checksum( const Record& record )
+    {
+        uint32_t uCrc = IXCrc32( &record.m_ullSequence, sizeof( record.m_ullSequence ) );
+        return IXCrc32( &record.m_iTimestamp, sizeof( record.m_iTimestamp ), uCrc );
+    }
+
+    // Checks whether a record is intact.
+    static bool IsValid( const Record& record )
+    {
+        return record.m_ullSequence != 0 && record.m_uChecksum == Checksum( record );
+    }
+
+    // Accesses the header.
+    Header* AccessHeader() const { return reinterpret_cast< Header* >( m_file.AccessData() ); }
+
+    // Accesses the specified record slot.
+    Record* AccessRecord( size_t stSlot ) const
+    {
+        return reinterpret_cast< Record* >( m_file.AccessData() + c_stHeaderSize ) + stSlot;
+    }
+
+private:
+    CIXMappedFile m_file;  // Mapped journal.
+    uint64_t m_ullLatest;  // Sequence number of the latest record.
+    CLogicalTimestamp m_ltLatest;  // Latest committed timestamp.
+};
+
+// Layout of the append-only item log. The items are appended to blocks of a fixed capacity,
+// and each block holds its items column by column, so that a run of items within a block can
+// be viewed in place as CIXItemColumnsView. The writer publishes a new block by incrementing
+// the block count of the header and an item by incrementing the item count of its block, both
+// with release semantics, so that the readers can follow the log while it is being written.
+// The readers waiting for new items are woken through the notification word of the header.
+class CIXItemLogFormat
+{
+public:
+
+    // Log header.
+    struct Header
+    {
+        uint32_t m_uMagic;  // File identification.
+        uint32_t m_uBlockItems;  // Item capacity of each block.
+        uint64_t m_ullBlocks;  // Number of blocks published.
+        uint32_t m_uNotifications;  // Incremented by the writer to wake the readers waiting for items.
+    };
+
+    // Block header.
+    struct BlockHeader
+    {
+        uint32_t m_uCount;  // Number of items published.
+        int32_t m_iFirst;  // Timestamp of the first item, set before the block is published.
+    };
+
+    // Constants.
+    static const uint32_t c_uMagic = 0x4C495849;  // "IXIL"
+    static const size_t c_stHeaderSize = 64;
+    static const size_t c_stBlockHeaderSize = 64;
+    static const int c_iColumns = 4;  // I, J, K and the timestamps.
+
+    // Gets the size of a block with the specified capacity.
+    static size_t GetBlockSize( uint32_t uBlockItems )
+    {
+        return c_stBlockHeaderSize + c_iColumns * uBlockItems * sizeof( int32_t );
+    }
+
+    // Gets the size of a log with the specified number of blocks.
+    static size_t GetLogSize( uint32_t uBlockItems, uint64_t ullBlocks )
+    {
+        return c_stHeaderSize + static_cast< size_t >( ullBlocks ) * GetBlockSize( uBlockItems );
+    }
+
+    // Accesses the header of the specified block.
+    static BlockHeader* AccessBlock( char* pData, uint32_t uBlockItems, uint64_t ullBlock )
+    {
+        return reinterpret_cast< BlockHeader* >( pData + GetLogSize( uBlockItems, ullBlock ) );
+    }
+
+    // Accesses the specified column of the specified block.
+    static int32_t* AccessColumn( char* pData, uint32_t uBlockItems, uint64_t ullBlock, int iColumn )
+    {
+        return reinterpret_cast< int32_t* >( reinterpret_cast< char* >( AccessBlock( pData, uBlockItems, ullBlock ) ) +
+                c_stBlockHeaderSize ) + static_cast< size_t >( iColumn ) * uBlockItems;
+    }
+};
+
+// Writer of the append-only item log. The items must be appended in timestamp order, but the
+// timestamps need not be contiguous. The file is extended by doubling as the log grows.
+class CIXItemLogWriter : public CLifeReporterAgent< CIXItemLogWriter >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXItemLogWriter > SHP;
+
+    // Factory method. An existing log is appended to.
+    static SHP Create( const string& szPath, uint32_t uBlockItems = 1024 )
+    {
+        // Map and validate the log.
+        SHP shp( new CIXItemLogWriter( szPath ) );
+        if( uBlockItems == 0 || shp->Open( uBlockItems ) == false )
+            return SHP();
+        return shp;
+    }
+
+    // Destructor.
+    virtual ~CIXItemLogWriter()
+    {
+    }
+
+    // Appends an item. Fails unless the item is later than the previous one.
+    bool Append( const CIXItem& item )
+    {
+        // Keep the order.
+        if( m_bEmpty == false && item.AccessLT().IsLaterThan( m_ltLatest ) == false )
+            return false;
+
+        // Start a new block if the current one is full.
+        CIXItemLogFormat::Header* pHeader = AccessHeader();
+        uint64_t ullBlocks = atomic_ref< uint64_t >( pHeader->m_ullBlocks ).load( memory_order_relaxed );
+        if( ullBlocks == 0 || CIXItemLogFormat::AccessBlock( m_file.AccessData(), m_uBlockItems, ullBlocks - 1 )->m_uCount == m_uBlockItems )
+        {
+            // Make room for the block.
+            if( Reserve( ullBlocks + 1 ) == false )
+                return false;
+            pHeader = AccessHeader();
+
+            // Publish the block.
+            CIXItemLogFormat::BlockHeader* pBlock = CIXItemLogFormat::AccessBlock( m_file.AccessData(), m_uBlockItems, ullBlocks );
+            pBlock->m_uCount = 0;
+            pBlock->m_iFirst = item.AccessLT().Get();
+            atomic_ref< uint64_t >( pHeader->m_ullBlocks ).store( ++ullBlocks, memory_order_release );  // void
+
+        }  // end if
+
+        // Write the item into the columns and then publish it.
+        CIXItemLogFormat::BlockHeader* pBlock = CIXItemLogFormat::AccessBlock( m_file.AccessData(), m_uBlockItems, ullBlocks - 1 );
+        uint32_t uSlot = pBlock->m_uCount;
+        if( uSlot == 0 )
+            pBlock->m_iFirst = item.AccessLT().Get();
+        CIXItemLogFormat::AccessColumn( m_file.AccessData(), m_uBlockItems, ullBlocks - 1, 0 )[ uSlot ] = item.GetI();
+        CIXItemLogFormat::AccessColumn( m_file.AccessData(), m_uBlockItems, ullBlocks - 1, 1 )[ uSlot ] = item.GetJ();
+        CIXItemLogFormat::AccessColumn( m_file.AccessData(), m_uBlockItems, ullBlocks - 1, 2 )[ uSlot ] = item.GetK();
+        CIXItemLogFormat::AccessColumn( m_file.AccessData(), m_uBlockItems, ullBlocks - 1, 3 )[ uSlot ] = item.AccessLT().Get();
+        atomic_ref< uint32_t >( pBlock->m_uCount ).store( uSlot + 1, memory_order_release );  // void
+
+        // Track.
+        m_ltLatest = item.AccessLT();
+        m_bEmpty = false;
+        return true;
+    }
+
+    // Wakes the readers waiting for new items. Called after appending a run of items, so
+    // that the cost of waking is shared by them.
+    void Notify()
+    {
+        // Signal.
+        CIXItemLogFormat::Header* pHeader = AccessHeader();
+        atomic_ref< uint32_t >( pHeader->m_uNotifications ).fetch_add( 1 );  // Return value ignored.
+        IXWakeOnWord( &pHeader->m_uNotifications );  // void
+    }
+
+    // Writes the log durably to the disk.
+    bool Flush()
+    {
+        // Up to the end of the latest block.
+        return m_file.Flush( 0, CIXItemLogFormat::GetLogSize( m_uBlockItems, AccessHeader()->m_ullBlocks ) );
+    }
+
+    // Gets the timestamp of the latest item, or zero if there is none.
+    CLogicalTimestamp GetLatest() const
+    {
+        return m_ltLatest;
+    }
+
+private:
+
+    // Constructor.
+    CIXItemLogWriter( const string& szPath )
+        : m_szPath( szPath ), m_uBlockItems( 0 ), m_bEmpty( true )
+    {
+    }
+
+    // Maps the log and finds the latest item.
+    bool Open( uint32_t uBlockItems )
+    {
+        // Map the file, creating it if necessary.
+        if( m_file.Open( m_szPath, CIXItemLogFormat::GetLogSize( uBlockItems, 1 ), true ) == false )
+            return false;
+
+        // Initialize a new log.
+        CIXItemLogFormat::Header* pHeader = AccessHeader();
+        if( pHeader->m_uMagic == 0 && pHeader->m_uBlockItems == 0 )
+        {
+            pHeader->m_uBlockItems = uBlockItems;
+            pHeader->m_ullBlocks = 0;
+            pHeader->m_uMagic = CIXItemLogFormat::c_uMagic;
+            m_uBlockItems = uBlockItems;
+            return m_file.Flush( 0, sizeof( CIXItemLogFormat::Header ) );
+
+        }  // end if
+
+        // Validate an existing one.
+        m_uBlockItems = pHeader->m_uBlockItems;
+        if( pHeader->m_uMagic != CIXItemLogFormat::c_uMagic || m_uBlockItems == 0 ||
+                m_file.GetSize() < CIXItemLogFormat::GetLogSize( m_uBlockItems, pHeader->m_ullBlocks ) )
+            return false;
+
+        // Continue after the latest item. A block may have been published without any items.
+        for( uint64_t ullBlock = pHeader->m_ullBlocks; ullBlock > 0 && m_bEmpty; ullBlock-- )
+        {
+            uint32_t uCount = CIXItemLogFormat::AccessBlock( m_file.AccessData(), m_uBlockItems, ullBlock - 1 )->m_uCount;
+            if( uCount == 0 )
+                continue;
+            m_ltLatest = CLogicalTimestamp( CIXItemLogFormat::AccessColumn( m_file.AccessData(), m_uBlockItems, ullBlock - 1, 3 )[ uCount - 1 ] );
+            m_bEmpty = false;
+
+        }  // end for
+        return true;
+    }
+
+    // Extends the file to hold at least the specified number of blocks.
+    bool Reserve( uint64_t ullBlocks )
+    {
+        // Double the size when extending. The readers map the file again when they notice.
+        size_t stSize = CIXItemLogFormat::GetLogSize( m_uBlockItems, ullBlocks );
+        if( m_file.GetSize() >= stSize )
+            return true;
+        return m_file.Open( m_szPath, std::max( stSize, m_file.GetSize() * 2 ), true );
+    }
+
+    // Accesses the header.
+    CIXItemLogFormat::Header* AccessHeader() const { return reinterpret_cast< CIXItemLogFormat::Header* >( m_file.AccessData() ); }
+
+private:
+    string m_szPath;  // Path of the log.
+    CIXMappedFile m_file;  // Mapped log.
+    uint32_t m_uBlockItems;  // Item capacity of each block.
+    CLogicalTimestamp m_ltLatest;  // Timestamp of the latest item.
+    bool m_bEmpty;  // Indicates whether the log has no items.
+};
+
+// Data retrieval over the append-only item log. The log is mapped into memory and the first
+// timestamp of each block is kept as a sparse index, so that a retrieval finds its start by
+// a binary search over the blocks and then within the block. The timestamps may have gaps.
+// Retrieving column by column is zero-copy: the columns refer to the mapping directly. A chunk
+// does not span blocks, so it may be shorter than requested. The log may be appended to while
+// it is being read; a grown file is mapped again, and the previous mappings are kept, so that
+// the columns handed out earlier stay valid for the lifetime of this object.
+class CIXItemLogDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXItemLogDataRetrieval >
+{
+public:
+
+    // Factory method.
+    static IIXDataRetrieval::SHP Create( const string& szPath )
+    {
+        // Map and validate the log.
+        shared_ptr< CIXItemLogDataRetrieval > shp( new CIXItemLogDataRetrieval( szPath ) );
+        if( shp->Map() == false )
+            return IIXDataRetrieval::SHP();
+        return shp;
+    }
+
+    // Destructor.
+    virtual ~CIXItemLogDataRetrieval()
+    {
+    }
+
+// IIXDataRetrieval
+public:
+
+    // Returns the timestamp of the latest item in the log, which bounds the items as the count does for
+    // the sources with contiguous timestamps.
+    virtual int GetGloballyAvailable() override
+    {
+        // Find the latest item.
+        Refresh();  // void
+        for( uint64_t ullBlock = m_vecFirst.size(); ullBlock > 0; ullBlock-- )
+        {
+            uint32_t uCount = GetCount( ullBlock - 1 );
+            if( uCount > 0 )
+                return AccessColumn( ullBlock - 1, 3 )[ uCount - 1 ];
+
+        }  // end for
+        return 0;
+    }
+
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
+    {
+        // Copy the rows out of the columns.
+        CIXItemColumnsView columns;
+        CLogicalTimestamp ltLatestKnown = Find( ltLatestSeen, iCount, OUT bExhausted, OUT columns );
+        vecItems.clear();
+        vecItems.reserve( columns.GetSize() );
+        for( size_t stItem = 0; stItem < columns.GetSize(); stItem++ )
+            vecItems.push_back( columns.Row( stItem ) );
+        return CResult< CLogicalTimestamp >( true, ltLatestKnown );
+    }
+
+    // Retrieves data column by column.
+    virtual CResult< CLogicalTimestamp > RetrieveColumns(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT CIXItemColumns& columns
+    ) override
+    {
+        // Refer to the mapping.
+        CIXItemColumnsView view;
+        CLogicalTimestamp ltLatestKnown = Find( ltLatestSeen, iCount, OUT bExhausted, OUT view );
+        columns.Borrow( view );  // void
+        return CResult< CLogicalTimestamp >( true, ltLatestKnown );
+    }
+
+    // Waits until items later than the specified timestamp are available, or the timeout passes.
+    virtual bool WaitForData( const CLogicalTimestamp& ltLatestSeen, chrono::milliseconds msTimeout ) override
+    {
+        // Check the items after taking the notification count, so that no notification is missed in between.
+        chrono::steady_clock::time_point tpDeadline = chrono::steady_clock::now() + msTimeout;
+        while( true )
+        {
+            uint32_t uNotifications = atomic_ref< uint32_t >( AccessHeader()->m_uNotifications ).load();
+            if( GetGloballyAvailable() > ltLatestSeen.Get() )
+                return true;
+            chrono::steady_clock::time_point tpNow = chrono::steady_clock::now();
+            if( tpNow >= tpDeadline )
+                return false;
+            IXWaitOnWord( &AccessHeader()->m_uNotifications, uNotifications, tpDeadline - tpNow );  // void
+
+        }  // end while
+    }
+
+private:
+
+    // Constructor.
+    CIXItemLogDataRetrieval( const string& szPath )
+        : m_szPath( szPath ), m_uBlockItems( 0 )
+    {
+    }
+
+    // Finds the items after the specified timestamp within one block.
+    CLogicalTimestamp Find( const CLogicalTimestamp& ltLatestSeen, int iCount, OUT bool& bExhausted, OUT CIXItemColumnsView& columns )
+    {
+        // Start from the latest block beginning no later than the timestamp.
+        Refresh();  // void
+        vector< int32_t >::const_iterator it = upper_bound( m_vecFirst.begin(), m_vecFirst.end(), ltLatestSeen.Get() );
+        uint64_t ullBlock = it == m_vecFirst.begin() ? 0 : static_cast< uint64_t >( it - m_vecFirst.begin() ) - 1;
+        CLogicalTimestamp ltLatestKnown = ltLatestSeen;
+        columns = CIXItemColumnsView();
+        bExhausted = true;
+        for( ; ullBlock < m_vecFirst.size() && iCount > 0; ullBlock++ )
+        {
+            // Find the first later item within the block. The block may end before it.
+            uint32_t uCount = GetCount( ullBlock );
+            const int32_t* piTimestamps = AccessColumn( ullBlock, 3 );
+            size_t stStart = static_cast< size_t >( upper_bound( piTimestamps, piTimestamps + uCount, ltLatestSeen.Get() ) - piTimestamps );
+            if( stStart == uCount )
+                continue;
+
+            // View the items in place.
+            size_t stTaken = std::min( static_cast< size_t >( iCount ), uCount - stStart );
+            columns = CIXItemColumnsView( AccessColumn( ullBlock, 0 ) + stStart, AccessColumn( ullBlock, 1 ) + stStart,
+                    AccessColumn( ullBlock, 2 ) + stStart, piTimestamps + stStart, stTaken );
+            ltLatestKnown = CLogicalTimestamp( piTimestamps[ stStart + stTaken - 1 ] );
+            bExhausted = ullBlock + 1 == m_vecFirst.size() && stStart + stTaken == uCount;
+            break;
+
+        }  // end for
+
+        // Debug output.
+        IX_LOG( Debug, Indent( 2 ) <<
+                "Retrieved " <<
+                columns.GetSize() <<
+                " items. Latest known timestamp is " <<
+                ltLatestKnown.Get() <<
+                "." );
+
+        return ltLatestKnown;
+    }
+
+    // Follows the writer: maps the grown file and indexes the new blocks.
+    void Refresh()
+    {
+        // Map the file again if the published blocks do not fit in the mapping.
+        uint64_t ullBlocks = atomic_ref< uint64_t >( AccessHeader()->m_ullBlocks ).load( memory_order_acquire );
+        if( CIXItemLogFormat::GetLogSize( m_uBlockItems, ullBlocks ) > m_upFile->GetSize() )
+        {
+            unique_ptr< CIXMappedFile > upFile( new CIXMappedFile );
+            if( upFile->Open( m_szPath, 0, false ) )
+            {
+                m_vecRetired.push_back( std::move( m_upFile ) );  // void
+                m_upFile = std::move( upFile );
+
+            }  // end if
+            ullBlocks = std::min( ullBlocks, static_cast< uint64_t >(
+                    ( m_upFile->GetSize() - CIXItemLogFormat::c_stHeaderSize ) / CIXItemLogFormat::GetBlockSize( m_uBlockItems ) ) );
+
+        }  // end if
+
+        // Index the first timestamps of the new blocks.
+        for( uint64_t ullBlock = m_vecFirst.size(); ullBlock < ullBlocks; ullBlock++ )
+            m_vecFirst.push_back( CIXItemLogFormat::AccessBlock( m_upFile->AccessData(), m_uBlockItems, ullBlock )->m_iFirst );  // void
+    }
+
+    // Maps the log.
+    bool Map()
+    {
+        // Map and validate the header.
+        m_upFile.reset( new CIXMappedFile );
+        if( m_upFile->Open( m_szPath, 0, false ) == false || m_upFile->GetSize() < CIXItemLogFormat::c_stHeaderSize )
+            return false;
+        const CIXItemLogFormat::Header* pHeader = AccessHeader();
+        m_uBlockItems = pHeader->m_uBlockItems;
+        return pHeader->m_uMagic == CIXItemLogFormat::c_uMagic && m_uBlockItems > 0;
+    }
+
+    // Gets the number of items published in the specified block.
+    uint32_t GetCount( uint64_t ullBlock ) const
+    {
+        return std::min( m_uBlockItems, atomic_ref< uint32_t >(
+                CIXItemLogFormat::AccessBlock( m_upFile->AccessData(), m_uBlockItems, ullBlock )->m_uCount ).load( memory_order_acquire ) );
+    }
+
+    // Accesses the specified column of the specified block.
+    const int32_t* AccessColumn( uint64_t ullBlock, int iColumn ) const
+    {
+        return CIXItemLogFormat::AccessColumn( m_upFile->AccessData(), m_uBlockItems, ullBlock, iColumn );
+    }
+
+    // Accesses the header.
+    CIXItemLogFormat::Header* AccessHeader() const { return reinterpret_cast< CIXItemLogFormat::Header* >( m_upFile->AccessData() ); }
+
+private:
+    string m_szPath;  // Path of the log.
+    unique_ptr< CIXMappedFile > m_upFile;  // Current mapping.
+    vector< unique_ptr< CIXMappedFile > > m_vecRetired;  // Previous mappings, still referred to by the columns handed out.
+    uint32_t m_uBlockItems;  // Item capacity of each block.
+    vector< int32_t > m_vecFirst;  // First timestamp of each block.
+};
+
+// Helpers for encoding the postings.
+namespace
+{
+    // Appends a variable-length encoded value, 7 bits per byte.
+    void IXAppendVarint( vector< uint8_t >& vecBytes, uint32_t u )
+    {
+        while( u >= 0x80 )
+        {
+            vecBytes.push_back( static_cast< uint8_t >( u | 0x80 ) );
+            u >>= 7;
+        }
+        vecBytes.push_back( static_cast< uint8_t >( u ) );
+    }
+
+    // Reads a variable-length encoded value and proceeds past it, not past the specified end.
+    uint32_t IXReadVarint( const uint8_t*& pb, const uint8_t* pbEnd )
+    {
+        uint32_t u = 0;
+        for( int iShift = 0; pb < pbEnd && iShift < 32; iShift += 7 )
+        {
+            uint8_t b = *pb++;
+            u |= static_cast< uint32_t >( b & 0x7F ) << iShift;
+            if( ( b & 0x80 ) == 0 )
+                break;
+        }
+        return u;
+    }
+}
+
+// Posting list of the timestamps of the items containing one indexed value. The timestamps
+// are delta-encoded in blocks, each of which has its first and last timestamp in a separate
+// header, so that the blocks outside a timestamp range can be skipped without decoding them.
+class CIXPostingList
+{
+public:
+
+    // Maximum number of postings per block.
+    static const int c_iBlockSize = 128;
+
+    // Block header. Also the on-disk format within the segments.
+    struct Block
+    {
+        int32_t m_iFirst;  // First timestamp, stored here instead of the encoded bytes.
+        int32_t m_iLast;  // Last timestamp.
+        int32_t m_iCount;  // Number of postings.
+        uint32_t m_uOffset;  // Offset of the encoded deltas.
+    };
+
+    // Adds a posting. A timestamp earlier than the last one starts a new block, which
+    // keeps the deltas non-negative and the block headers accurate.
+    void Add( int iTimestamp )
+    {
+        // Start a new block if necessary.
+        if( m_vecBlocks.empty() || m_vecBlocks.back().m_iCount == c_iBlockSize || iTimestamp < m_vecBlocks.back().m_iLast )
+        {
+            m_vecBlocks.push_back( Block{ iTimestamp, iTimestamp, 1, static_cast< uint32_t >( m_vecBytes.size() ) } );
+            return;
+
+        }  // end if
+
+        // Append the delta.
+        Block& block = m_vecBlocks.back();
+        IXAppendVarint( m_vecBytes, static_cast< uint32_t >( iTimestamp - block.m_iLast ) );  // void
+        block.m_iLast = iTimestamp;
+        block.m_iCount++;
+    }
+
+    // Passes the timestamps within the specified inclusive range to the specified function.
+    template< typename TVisit >
+    void Scan( int iFrom, int iTo, TVisit visit ) const
+    {
+        // Delegate.
+        ScanBlocks( m_vecBlocks, m_vecBytes.data(), m_vecBytes.size(), iFrom, iTo, visit );  // void
+    }
+
+    // Passes the timestamps of the specified blocks within the specified inclusive range to
+    // the specified function. The blocks are decoded within the specified bytes only.
+    template< typename TVisit >
+    static void ScanBlocks( span< const Block > blocks, const uint8_t* pbBytes, size_t stBytes, int iFrom, int iTo, TVisit visit )
+    {
+        for( const Block& block : blocks )
+        {
+            // Skip the blocks outside the range.
+            if( block.m_iLast < iFrom || block.m_iFirst > iTo )
+                continue;
+
+            // Decode the block.
+            const uint8_t* pb = pbBytes + block.m_uOffset;
+            int iTimestamp = block.m_iFirst;
+            for( int iPosting = 0; iPosting < block.m_iCount; iPosting++ )
+            {
+                if( iPosting > 0 )
+                    iTimestamp += static_cast< int >( IXReadVarint( pb, pbBytes + stBytes ) );
+                if( iTimestamp > iTo )
+                    break;
+                if( iTimestamp >= iFrom )
+                    visit( iTimestamp );  // void
+
+            }  // end for
+
+        }  // end for
+    }
+
+    // Accesses the encoded postings.
+    span< const Block > AccessBlocks() const { return m_vecBlocks; }
+    const vector< uint8_t >& AccessBytes() const { return m_vecBytes; }
+
+    // Gets the memory used by the encoded postings.
+    size_t GetBytes() const { return m_vecBytes.size() + m_vecBlocks.size() * sizeof( Block ); }
+
+private:
+    vector< Block > m_vecBlocks;  // Block headers.
+    vector< uint8_t > m_vecBytes;  // Encoded deltas of all blocks.
+};
+
+// Table from the indexed values to their posting lists, with open addressing and linear probing.
+class CIXPostingTable
+{
+public:
+
+    // Hash table slot.
+    struct Slot
+    {
+        uint32_t m_uKey = 0;  // Derived key of the value.
+        int m_iField = 0;  // Field.
+        int m_iValue = 0;  // Value.
+        int m_iList = -1;  // Index of the posting list, or -1 if the slot is free.
+    };
+
+    // Constructor.
+    CIXPostingTable()
+    {
+        // Start with a small table.
+        m_vecSlots.resize( c_stInitialSize );
+    }
+
+    // Finds the posting list of the specified value.
+    const CIXPostingList* Find( int iField, int iValue, uint32_t uKey ) const
+    {
+        // Probe until a free slot.
+        size_t stMask = m_vecSlots.size() - 1;
+        for( size_t st = uKey & stMask; ; st = ( st + 1 ) & stMask )
+        {
+            const Slot& slot = m_vecSlots[ st ];
+            if( slot.m_iList < 0 )
+                return nullptr;
+            if( slot.m_uKey == uKey && slot.m_iField == iField && slot.m_iValue == iValue )
+                return &m_vecLists[ slot.m_iList ];
+        }
+    }
+
+    // Adds a posting to the specified value.
+    void Add( int iField, int iValue, uint32_t uKey, int iTimestamp )
+    {
+        // Keep the load factor at most one half.
+        Reserve( m_vecLists.size() + 1 );  // void
+        AddAt( uKey & GetBucketMask(), iField, iValue, uKey, iTimestamp );  // void
+    }
+
+    // Adds a posting to the specified value, probing from the specified bucket. The table
+    // must have room for the value.
+    void AddAt( uint32_t uBucket, int iField, int iValue, uint32_t uKey, int iTimestamp )
+    {
+        // Probe until the value or a free slot.
+        size_t stMask = m_vecSlots.size() - 1;
+        for( size_t st = uBucket; ; st = ( st + 1 ) & stMask )
+        {
+            Slot& slot = m_vecSlots[ st ];
+            if( slot.m_iList < 0 )
+            {
+                // New value.
+                slot.m_uKey = uKey;
+                slot.m_iField = iField;
+                slot.m_iValue = iValue;
+                slot.m_iList = static_cast< int >( m_vecLists.size() );
+                m_vecLists.push_back( CIXPostingList() );
+            }
+            if( slot.m_uKey == uKey && slot.m_iField == iField && slot.m_iValue == iValue )
+            {
+                m_vecLists[ slot.m_iList ].Add( iTimestamp );  // void
+                return;
+            }
+        }
+    }
+
+    // Grows the table to hold at least the specified number of values.
+    void Reserve( size_t stValues )
+    {
+        // Double until the load factor is at most one half.
+        size_t stSize = m_vecSlots.size();
+        while( stValues * 2 > stSize )
+            stSize *= 2;
+        if( stSize == m_vecSlots.size() )
+            return;
+
+        // Rehash using the stored keys.
+        vector< Slot > vecOld( stSize );
+        vecOld.swap( m_vecSlots );
+        size_t stMask = stSize - 1;
+        for( const Slot& slot : vecOld )
+        {
+            if( slot.m_iList < 0 )
+                continue;
+            size_t st = slot.m_uKey & stMask;
+            while( m_vecSlots[ st ].m_iList >= 0 )
+                st = ( st + 1 ) & stMask;
+            m_vecSlots[ st ] = slot;
+
+        }  // end for
+    }
+
+    // Gets the mask turning the keys into buckets.
+    uint32_t GetBucketMask() const { return static_cast< uint32_t >( m_vecSlots.size() - 1 ); }
+
+    // Passes each value and its posting list to the specified function.
+    template< typename TVisit >
+    void ForEach( TVisit visit ) const
+    {
+        for( const Slot& slot : m_vecSlots )
+        {
+            if( slot.m_iList >= 0 )
+                visit( slot, m_vecLists[ slot.m_iList ] );  // void
+        }
+    }
+
+    // Gets the number of values.
+    size_t GetValueCount() const { return m_vecLists.size(); }
+
+    // Gets the memory used by the encoded postings.
+    size_t GetBytes() const
+    {
+        size_t stBytes = 0;
+        for( const CIXPostingList& list : m_vecLists )
+            stBytes += list.GetBytes();
+        return stBytes;
+    }
+
+private:
+    static const size_t c_stInitialSize = 1024;  // Initial number of slots.
+    vector< Slot > m_vecSlots;  // Hash table, the size is a power of two.
+    vector< CIXPostingList > m_vecLists;  // Posting lists by value.
+};
+
+// Indexed items in their arrival order, in blocks with a sparse skip index of the earliest and
+// latest timestamp of each block. While the blocks do not overlap, the first block of a timestamp
+// range is found with a binary search, so a range scan costs in proportion to the result rather
+// than to the number of items stored.
+class CIXItemStore
+{
+public:
+
+    // Maximum number of items per block.
+    static const uint32_t c_uBlockSize = 256;
+
+    // Item record. Also the on-disk format within the segments.
+    struct Record
+    {
+        int32_t m_iTimestamp;  // Timestamp.
+        int32_t m_i;  // Indexable data.
+        int32_t m_j;  // Indexable data.
+        int32_t m_k;  // Indexable data.
+    };
+
+    // Skip index entry. Also the on-disk format within the segments.
+    struct Block
+    {
+        int32_t m_iMin;  // Earliest timestamp.
+        int32_t m_iMax;  // Latest timestamp.
+        uint32_t m_uFirst;  // First record.
+        uint32_t m_uCount;  // Number of records.
+    };
+
+    // Constructor.
+    CIXItemStore()
+        : m_bOrdered( true )
+    {
+    }
+
+    // Appends an item.
+    void Append( int i, int j, int k, int iTimestamp )
+    {
+        // Start a new block if necessary.
+        if( m_vecBlocks.empty() || m_vecBlocks.back().m_uCount == c_uBlockSize )
+            m_vecBlocks.push_back( Block{ iTimestamp, iTimestamp, static_cast< uint32_t >( m_vecRecords.size() ), 0 } );
+
+        // Track the range of the block. Once it overlaps the previous one, binary search is off.
+        Block& block = m_vecBlocks.back();
+        block.m_iMin = std::min( block.m_iMin, iTimestamp );
+        block.m_iMax = std::max( block.m_iMax, iTimestamp );
+        block.m_uCount++;
+        if( m_vecBlocks.size() > 1 && block.m_iMin < m_vecBlocks[ m_vecBlocks.size() - 2 ].m_iMax )
+            m_bOrdered = false;
+        m_vecRecords.push_back( Record{ iTimestamp, i, j, k } );
+    }
+
+    // Passes the records within the specified inclusive timestamp range to the specified function.
+    template< typename TVisit >
+    void Scan( int iFrom, int iTo, TVisit visit ) const
+    {
+        // Delegate.
+        ScanBlocks( m_vecBlocks, m_vecRecords.data(), m_bOrdered, iFrom, iTo, visit );  // void
+    }
+
+    // Passes the records of the specified blocks within the specified inclusive timestamp range to
+    // the specified function. Ordered blocks do not overlap.
+    template< typename TVisit >
+    static void ScanBlocks( span< const Block > blocks, const Record* pRecords, bool bOrdered, int iFrom, int iTo, TVisit visit )
+    {
+        // Skip the blocks before the range.
+        size_t stBlock = 0;
+        if( bOrdered )
+            stBlock = lower_bound( blocks.begin(), blocks.end(), iFrom,
+                    []( const Block& block, int iTimestamp ) { return block.m_iMax < iTimestamp; } ) - blocks.begin();
+        for( ; stBlock < blocks.size(); stBlock++ )
+        {
+            // Skip the blocks outside the range, and stop after it if ordered.
+            const Block& block = blocks[ stBlock ];
+            if( block.m_iMin > iTo )
+            {
+                if( bOrdered )
+                    break;
+                continue;
+            }
+            if( block.m_iMax < iFrom )
+                continue;
+
+            // Check the records.
+            for( uint32_t u = block.m_uFirst; u < block.m_uFirst + block.m_uCount; u++ )
+            {
+                if( pRecords[ u ].m_iTimestamp >= iFrom && pRecords[ u ].m_iTimestamp <= iTo )
+                    visit( pRecords[ u ] );  // void
+            }
+
+        }  // end for
+    }
+
+    // Accesses the contents.
+    span< const Block > AccessBlocks() const { return m_vecBlocks; }
+    span< const Record > AccessRecords() const { return m_vecRecords; }
+    bool IsOrdered() const { return m_bOrdered; }
+
+    // Gets the number of items.
+    size_t GetCount() const { return m_vecRecords.size(); }
+
+    // Gets the earliest timestamp, or INT_MAX if empty.
+    int GetEarliest() const
+    {
+        int iEarliest = INT_MAX;
+        for( const Block& block : m_vecBlocks )
+            iEarliest = std::min( iEarliest, block.m_iMin );
+        return iEarliest;
+    }
+
+    // Gets the latest timestamp, or INT_MIN if empty.
+    int GetLatest() const
+    {
+        int iLatest = INT_MIN;
+        for( const Block& block : m_vecBlocks )
+            iLatest = std::max( iLatest, block.m_iMax );
+        return iLatest;
+    }
+
+private:
+    vector< Block > m_vecBlocks;  // Skip index.
+    vector< Record > m_vecRecords;  // Items.
+    bool m_bOrdered;  // Indicates whether the blocks do not overlap.
+};
+
+// Immutable index segment in a memory-mapped file. The file consists of a header, the values
+// sorted by their key, the block headers of their posting lists, the encoded postings and the
+// items sorted by their timestamp together with their skip index.
+// The file name carries the commit timestamp and the number of items, so a segment is mapped only
+// when a query or a merge first reads it, and an obsolete segment deletes its file when the
+// last user releases it.
+class CIXSegment : public CLifeReporterAgent< CIXSegment >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXSegment > SHP;
+
+    // Value entry.
+    struct Entry
+    {
+        uint32_t m_uKey;  // Derived key of the value.
+        int32_t m_iField;  // Field.
+        int32_t m_iValue;  // Value.
+        uint32_t m_uFirstBlock;  // First block of the posting list.
+        uint32_t m_uBlocks;  // Number of blocks of the posting list.
+    };
+
+    // Builds the contents of a segment.
+    class Builder
+    {
+    public:
+
+        // Appends a value. The values must be appended in the order of IsBefore().
+        void Append( uint32_t uKey, int iField, int iValue, const CIXPostingList& list )
+        {
+            // Relocate the blocks after the earlier postings.
+            uint32_t uBase = static_cast< uint32_t >( m_vecBytes.size() );
+            m_vecEntries.push_back( Entry{ uKey, iField, iValue, static_cast< uint32_t >( m_vecBlocks.size() ),
+                    static_cast< uint32_t >( list.AccessBlocks().size() ) } );
+            for( CIXPostingList::Block block : list.AccessBlocks() )
+            {
+                block.m_uOffset += uBase;
+                m_vecBlocks.push_back( block );
+            }
+            m_vecBytes.insert( m_vecBytes.end(), list.AccessBytes().begin(), list.AccessBytes().end() );
+        }
+
+        // Sets the items, which are sorted by their timestamp.
+        void SetItems( vector< CIXItemStore::Record >& vecRecords )
+        {
+            // Sort and build the skip index.
+            sort( vecRecords.begin(), vecRecords.end(), IsRecordBefore );
+            m_items = CIXItemStore();
+            for( const CIXItemStore::Record& record : vecRecords )
+                m_items.Append( record.m_i, record.m_j, record.m_k, record.m_iTimestamp );  // void
+        }
+
+        // Writes the segment file. The file appears under its name only when complete.
+        bool Write( const string& szPath, int iLevel, const CLogicalTimestamp& ltCommitted ) const
+        {
+            // Map a temporary file of the final size. The item section is aligned.
+            size_t stEntries = m_vecEntries.size() * sizeof( Entry );
+            size_t stBlocks = m_vecBlocks.size() * sizeof( CIXPostingList::Block );
+            size_t stItems = GetItemOffset( stEntries + stBlocks + m_vecBytes.size() );
+            size_t stItemBlocks = m_items.AccessBlocks().size() * sizeof( CIXItemStore::Block );
+            size_t stRecords = m_items.AccessRecords().size() * sizeof( CIXItemStore::Record );
+            size_t stSize = stItems + stItemBlocks + stRecords;
+            string szTemporary = szPath + ".tmp";
+            error_code ec;
+            filesystem::remove( szTemporary, ec );  // Return value ignored.
+            CIXMappedFile file;
+            if( file.Open( szTemporary, stSize, true ) == false )
+                return false;
+
+            // Fill it.
+            Header header = {};
+            header.m_uMagic = c_uMagic;
+            header.m_uLevel = static_cast< uint32_t >( iLevel );
+            header.m_uValues = static_cast< uint32_t >( m_vecEntries.size() );
+            header.m_uBlocks = static_cast< uint32_t >( m_vecBlocks.size() );
+            header.m_uBytes = static_cast< uint32_t >( m_vecBytes.size() );
+            header.m_iCommitted = ltCommitted.Get();
+            header.m_uItems = static_cast< uint32_t >( m_items.AccessRecords().size() );
+            header.m_uItemBlocks = static_cast< uint32_t >( m_items.AccessBlocks().size() );
+            char* pData = file.AccessData();
+            memcpy( pData, &header, sizeof( Header ) );
+            if( stEntries > 0 )
+                memcpy( pData + sizeof( Header ), m_vecEntries.data(), stEntries );
+            if( stBlocks > 0 )
+                memcpy( pData + sizeof( Header ) + stEntries, m_vecBlocks.data(), stBlocks );
+            if( m_vecBytes.empty() == false )
+                memcpy( pData + sizeof( Header ) + stEntries + stBlocks, m_vecBytes.data(), m_vecBytes.size() );
+            if( stItemBlocks > 0 )
+                memcpy( pData + stItems, m_items.AccessBlocks().data(), stItemBlocks );
+            if( stRecords > 0 )
+                memcpy( pData + stItems + stItemBlocks, m_items.AccessRecords().data(), stRecords );
+
+            // Persist and publish, and persist the publishing too.
+            bool bSuccess = file.Flush( 0, stSize );
+            file.Close();  // void
+            if( bSuccess )
+                filesystem::rename( szTemporary, szPath, ec );  // void
+            return bSuccess && !ec && CIXMappedFile::FlushDirectory( filesystem::path( szPath ).parent_path().string() );
+        }
+
+    private:
+        vector< Entry > m_vecEntries;  // Values.
+        vector< CIXPostingList::Block > m_vecBlocks;  // Block headers.
+        vector< uint8_t > m_vecBytes;  // Encoded postings.
+        CIXItemStore m_items;  // Items.
+    };
+
+    // Constructor. Nothing is read until the segment is first accessed.
+    CIXSegment( const string& szPath, int iGeneration, int iLevel, const CLogicalTimestamp& ltCommitted, size_t stItems )
+        : m_szPath( szPath ), m_iGeneration( iGeneration ), m_iLevel( iLevel ), m_ltCommitted( ltCommitted ), m_stItems( stItems ),
+          m_bMapped( false ), m_bValid( false ), m_bObsolete( false )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXSegment()
+    {
+        // Delete the file of an obsolete segment.
+        m_file.Close();  // void
+        if( m_bObsolete.load() )
+        {
+            error_code ec;
+            filesystem::remove( m_szPath, ec );  // Return value ignored.
+
+        }  // end if
+    }
+
+    // Gets the file name of the specified segment.
+    static string GetFileName( int iGeneration, int iLevel, const CLogicalTimestamp& ltCommitted, size_t stItems )
+    {
+        return "seg-" + to_string( iGeneration ) + "-" + to_string( iLevel ) + "-" + to_string( ltCommitted.Get() ) + "-" +
+                to_string( stItems ) + ".ixs";
+    }
+
+    // Parses the file name of a segment. Returns false for other files.
+    static bool ParseFileName( const string& szName, OUT int& iGeneration, OUT int& iLevel, OUT CLogicalTimestamp& ltCommitted,
+            OUT size_t& stItems )
+    {
+        int iCommitted = 0;
+        char szSuffix[ 8 ] = {};
+        if( sscanf( szName.c_str(), "seg-%d-%d-%d-%zu.%7s", &iGeneration, &iLevel, &iCommitted, &stItems, szSuffix ) != 5 ||
+                strcmp( szSuffix, "ixs" ) != 0 )
+            return false;
+        ltCommitted = CLogicalTimestamp( iCommitted );
+        return true;
+    }
+
+    // Determines the order of the values within a segment.
+    static bool IsBefore( uint32_t uKey, int iField, int iValue, uint32_t uOtherKey, int iOtherField, int iOtherValue )
+    {
+        if( uKey != uOtherKey )
+            return uKey < uOtherKey;
+        if( iField != iOtherField )
+            return iField < iOtherField;
+        return iValue < iOtherValue;
+    }
+
+    // Writes the contents of the specified table and items as a new segment file.
+    static bool Write( const CIXPostingTable& table, const CIXItemStore& items, const string& szPath, const CLogicalTimestamp& ltCommitted )
+    {
+        // Sort the values.
+        vector< pair< const CIXPostingTable::Slot*, const CIXPostingList* > > vecValues;
+        vecValues.reserve( table.GetValueCount() );
+        table.ForEach( [ &vecValues ]( const CIXPostingTable::Slot& slot, const CIXPostingList& list )
+                { vecValues.push_back( make_pair( &slot, &list ) ); } );
+        sort( vecValues.begin(), vecValues.end(), []( const auto& p, const auto& q )
+                { return IsBefore( p.first->m_uKey, p.first->m_iField, p.first->m_iValue,
+                        q.first->m_uKey, q.first->m_iField, q.first->m_iValue ); } );
+
+        // Build and write.
+        Builder builder;
+        for( const auto& p : vecValues )
+            builder.Append( p.first->m_uKey, p.first->m_iField, p.first->m_iValue, *p.second );  // void
+        vector< CIXItemStore::Record > vecRecords( items.AccessRecords().begin(), items.AccessRecords().end() );
+        builder.SetItems( vecRecords );  // void
+        return builder.Write( szPath, 0, ltCommitted );
+    }
+
+    // Merges the specified segments, ordered by their generation, into a new segment file.
+    // The values are merged in their sorted order, so only one posting list is decoded at a time.
+    static bool Merge( const vector< CIXSegment::SHP >& vecInputs, const string& szPath, int iLevel )
+    {
+        // Map the inputs and collect their items.
+        CLogicalTimestamp ltCommitted;
+        vector< CIXItemStore::Record > vecRecords;
+        for( const CIXSegment::SHP& shpInput : vecInputs )
+        {
+            if( shpInput->Map() == false )
+                return false;
+            ltCommitted.UpdateIfLater( shpInput->AccessCommitted() );  // void
+            vecRecords.insert( vecRecords.end(), shpInput->AccessRecords().begin(), shpInput->AccessRecords().end() );
+
+        }  // end for
+
+        // Merge the values.
+        Builder builder;
+        vector< size_t > vecPositions( vecInputs.size(), 0 );
+        while( true )
+        {
+            // Find the first remaining value.
+            const Entry* pFirst = nullptr;
+            for( size_t stInput = 0; stInput < vecInputs.size(); stInput++ )
+            {
+                span< const Entry > entries = vecInputs[ stInput ]->AccessEntries();
+                if( vecPositions[ stInput ] < entries.size() )
+                {
+                    const Entry& entry = entries[ vecPositions[ stInput ] ];
+                    if( pFirst == nullptr || IsBefore( entry.m_uKey, entry.m_iField, entry.m_iValue,
+                            pFirst->m_uKey, pFirst->m_iField, pFirst->m_iValue ) )
+                        pFirst = &entry;
+                }
+            }
+            if( pFirst == nullptr )
+                break;
+
+            // Concatenate its postings from all inputs.
+            Entry entryFirst = *pFirst;
+            CIXPostingList list;
+            for( size_t stInput = 0; stInput < vecInputs.size(); stInput++ )
+            {
+                span< const Entry > entries = vecInputs[ stInput ]->AccessEntries();
+                if( vecPositions[ stInput ] < entries.size() &&
+                        IsBefore( entryFirst.m_uKey, entryFirst.m_iField, entryFirst.m_iValue,
+                                entries[ vecPositions[ stInput ] ].m_uKey, entries[ vecPositions[ stInput ] ].m_iField,
+                                entries[ vecPositions[ stInput ] ].m_iValue ) == false )
+                {
+                    vecInputs[ stInput ]->ScanEntry( entries[ vecPositions[ stInput ] ], INT_MIN, INT_MAX,
+                            [ &list ]( int iTimestamp ) { list.Add( iTimestamp ); } );  // void
+                    vecPositions[ stInput ]++;
+                }
+            }
+            builder.Append( entryFirst.m_uKey, entryFirst.m_iField, entryFirst.m_iValue, list );  // void
+
+        }  // end while
+
+        builder.SetItems( vecRecords );  // void
+        return builder.Write( szPath, iLevel, ltCommitted );
+    }
+
+    // Passes the timestamps of the specified value within the specified inclusive range to the
+    // specified function. Returns false if the segment cannot be read.
+    template< typename TVisit >
+    bool Scan( int iField, int iValue, uint32_t uKey, int iFrom, int iTo, TVisit visit )
+    {
+        // Binary search for the value.
+        if( Map() == false )
+            return false;
+        span< const Entry > entries = AccessEntries();
+        const Entry* pEntry = lower_bound( entries.data(), entries.data() + entries.size(), 0,
+                [ & ]( const Entry& entry, int ) { return IsBefore( entry.m_uKey, entry.m_iField, entry.m_iValue, uKey, iField, iValue ); } );
+        if( pEntry != entries.data() + entries.size() && pEntry->m_uKey == uKey && pEntry->m_iField == iField && pEntry->m_iValue == iValue )
+            ScanEntry( *pEntry, iFrom, iTo, visit );  // void
+        return true;
+    }
+
+    // Passes the items within the specified inclusive timestamp range to the specified function.
+    // Returns false if the segment cannot be read.
+    template< typename TVisit >
+    bool ScanItems( int iFrom, int iTo, TVisit visit )
+    {
+        // The items are sorted.
+        if( Map() == false )
+            return false;
+        CIXItemStore::ScanBlocks( AccessItemBlocks(), AccessRecords().data(), true, iFrom, iTo, visit );  // void
+        return true;
+    }
+
+    // Determines the order of the items within a segment.
+    static bool IsRecordBefore( const CIXItemStore::Record& a, const CIXItemStore::Record& b )
+    {
+        return tie( a.m_iTimestamp, a.m_i, a.m_j, a.m_k ) < tie( b.m_iTimestamp, b.m_i, b.m_j, b.m_k );
+    }
+
+    // Gets the identification.
+    const string& AccessPath() const { return m_szPath; }
+    int GetGeneration() const { return m_iGeneration; }
+    int GetLevel() const { return m_iLevel; }
+
+    // Gets the timestamp of the commit the segment was written at and the number of its items.
+    // Known from the file name, so the segment is not mapped.
+    const CLogicalTimestamp& AccessCommitted() const { return m_ltCommitted; }
+    size_t GetItemCount() const { return m_stItems; }
+
+    // Gets the size of the postings. Maps the segment.
+    size_t GetPostingBytes() { return Map() ? AccessHeader().m_uBytes + AccessHeader().m_uBlocks * sizeof( CIXPostingList::Block ) : 0; }
+
+    // Passes the field and value of each entry to the specified function. Returns false if the
+    // segment cannot be read.
+    template< typename TVisit >
+    bool ForEachValue( TVisit visit )
+    {
+        if( Map() == false )
+            return false;
+        for( const Entry& entry : AccessEntries() )
+            visit( entry.m_iField, entry.m_iValue );  // void
+        return true;
+    }
+
+    // Marks the segment to be deleted when released.
+    void MarkObsolete() { m_bObsolete.store( true ); }
+
+private:
+
+    // File identification.
+    static const uint32_t c_uMagic = 0x47535849;  // 'IXSG'
+
+    // File header.
+    struct Header
+    {
+        uint32_t m_uMagic;  // File identification.
+        uint32_t m_uLevel;  // Merge level.
+        uint32_t m_uValues;  // Number of values.
+        uint32_t m_uBlocks;  // Number of blocks.
+        uint32_t m_uBytes;  // Size of the encoded postings.
+        int32_t m_iCommitted;  // Commit timestamp.
+        uint32_t m_uItems;  // Number of items.
+        uint32_t m_uItemBlocks;  // Number of skip index entries of the items.
+        uint8_t m_rgbyReserved[ 32 ];  // Reserved.
+    };
+    static_assert( sizeof( Header ) == 64, "Unexpected segment header size." );
+
+    // Maps the file when first called. Returns false if it is not a valid segment.
+    bool Map()
+    {
+        // Map and validate once.
+        lock_guard< mutex > lock( m_mutexMap );
+        if( m_bMapped )
+            return m_bValid;
+        m_bMapped = true;
+        if( m_file.Open( m_szPath, 0, false ) == false || m_file.GetSize() < sizeof( Header ) )
+            return false;
+        const Header& header = AccessHeader();
+        m_bValid = header.m_uMagic == c_uMagic && header.m_iCommitted == m_ltCommitted.Get() && header.m_uItems == m_stItems &&
+                m_file.GetSize() >= GetItemOffset( static_cast< size_t >( header.m_uValues ) * sizeof( Entry ) +
+                        static_cast< size_t >( header.m_uBlocks ) * sizeof( CIXPostingList::Block ) + header.m_uBytes ) +
+                        static_cast< size_t >( header.m_uItemBlocks ) * sizeof( CIXItemStore::Block ) +
+                        static_cast< size_t >( header.m_uItems ) * sizeof( CIXItemStore::Record ) &&
+                IsConsistent();
+        if( m_bValid == false )
+            IX_LOG( Error, "Segment " << m_szPath << " is corrupt." );
+        return m_bValid;
+    }
+
+    // Checks that the references within a segment of a sufficient size stay within it, so that
+    // a corrupt segment is never read past its end.
+    bool IsConsistent() const
+    {
+        // The posting lists of the values.
+        const Header& header = AccessHeader();
+        for( const Entry& entry : AccessEntries() )
+        {
+            if( static_cast< uint64_t >( entry.m_uFirstBlock ) + entry.m_uBlocks > header.m_uBlocks )
+                return false;
+        }
+        for( const CIXPostingList::Block& block : AccessBlocks() )
+        {
+            if( block.m_uOffset > header.m_uBytes || block.m_iCount < 1 || block.m_iCount > CIXPostingList::c_iBlockSize )
+                return false;
+        }
+
+        // The skip index of the items.
+        for( const CIXItemStore::Block& block : AccessItemBlocks() )
+        {
+            if( static_cast< uint64_t >( block.m_uFirst ) + block.m_uCount > header.m_uItems )
+                return false;
+        }
+        return true;
+    }
+
+    // Gets the offset of the item section, which follows the postings of the specified size.
+    static size_t GetItemOffset( size_t stPostings )
+    {
+        // Align to the records.
+        size_t stOffset = sizeof( Header ) + stPostings;
+        return ( stOffset + sizeof( CIXItemStore::Record ) - 1 ) / sizeof( CIXItemStore::Record ) * sizeof( CIXItemStore::Record );
+    }
+
+    // Accesses the contents of a mapped segment.
+    const Header& AccessHeader() const { return *reinterpret_cast< const Header* >( m_file.AccessData() ); }
+    span< const Entry > AccessEntries() const
+    {
+        return span< const Entry >( reinterpret_cast< const Entry* >( m_file.AccessData() + sizeof( Header ) ), AccessHeader().m_uValues );
+    }
+    span< const CIXPostingList::Block > AccessBlocks() const
+    {
+        return span< const CIXPostingList::Block >( reinterpret_cast< const CIXPostingList::Block* >(
+                m_file.AccessData() + sizeof( Header ) + AccessHeader().m_uValues * sizeof( Entry ) ), AccessHeader().m_uBlocks );
+    }
+    const uint8_t* AccessBytes() const
+    {
+        return reinterpret_cast< const uint8_t* >( AccessBlocks().data() + AccessHeader().m_uBlocks );
+    }
+    span< const CIXItemStore::Block > AccessItemBlocks() const
+    {
+        size_t stOffset = GetItemOffset( AccessHeader().m_uValues * sizeof( Entry ) +
+                AccessHeader().m_uBlocks * sizeof( CIXPostingList::Block ) + AccessHeader().m_uBytes );
+        return span< const CIXItemStore::Block >( reinterpret_cast< const CIXItemStore::Block* >( m_file.AccessData() + stOffset ),
+                AccessHeader().m_uItemBlocks );
+    }
+    span< const CIXItemStore::Record > AccessRecords() const
+    {
+        return span< const CIXItemStore::Record >( reinterpret_cast< const CIXItemStore::Record* >(
+                AccessItemBlocks().data() + AccessHeader().m_uItemBlocks ), AccessHeader().m_uItems );
+    }
+
+    // Passes the timestamps of the specified entry within the specified inclusive range to the specified function.
+    template< typename TVisit >
+    void ScanEntry( const Entry& entry, int iFrom, int iTo, TVisit visit ) const
+    {
+        CIXPostingList::ScanBlocks( AccessBlocks().subspan( entry.m_uFirstBlock, entry.m_uBlocks ), AccessBytes(), AccessHeader().m_uBytes,
+                iFrom, iTo, visit );  // void
+    }
+
+private:
+    string m_szPath;  // File path.
+    int m_iGeneration;  // Generation, unique within the directory.
+    int m_iLevel;  // Merge level. Written by commits at zero.
+    CLogicalTimestamp m_ltCommitted;  // Commit timestamp.
+    size_t m_stItems;  // Number of items.
+    mutex m_mutexMap;  // Guards the mapping.
+    CIXMappedFile m_file;  // Mapped file.
+    bool m_bMapped;  // Indicates whether the mapping has been attempted.
+    bool m_bValid;  // Indicates whether the file is a valid segment.
+    atomic< bool > m_bObsolete;  // Indicates whether the file should be deleted on release.
+};
+
+// Query interface of an indexing engine. The queries see the committed items only.
+class IIXQuery
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXQuery > SHP;
+
+    // Finds the timestamps within the specified inclusive range of the items whose specified field
+    // has the specified value. The field is 0, 1 or 2 for I, J or K, respectively. The timestamps
+    // are in ascending order.
+    virtual void Lookup( int iField, int iValue, const CLogicalTimestamp& ltFrom, const CLogicalTimestamp& ltTo,
+            OUT vector< CLogicalTimestamp >& vecTimestamps ) const = 0;
+
+    // Finds the items within the specified inclusive timestamp range, in timestamp order.
+    virtual void ScanRange( const CLogicalTimestamp& ltFrom, const CLogicalTimestamp& ltTo, OUT vector< CIXItem >& vecItems ) const = 0;
+
+    // Finds the items of the specified timestamp.
+    virtual void LookupTimestamp( const CLogicalTimestamp& lt, OUT vector< CIXItem >& vecItems ) const = 0;
+
+    // Gets the timestamp of the latest commit.
+    virtual CLogicalTimestamp GetCommitted() const = 0;
+
+    // Destructor.
+    virtual ~IIXQuery()
+    {
+    }
+};
+
+// Inverted index from each indexed value of the I, J and K fields to the timestamps of the
+// items containing it. The values are kept in an open-addressing hash table and the items in a
+// store with a skip index for the timestamp range queries. Queries see the items up to the
+// timestamp of the latest commit and may run concurrently with the indexing.
+//
+// With a directory, each commit flushes the buffered items up to its timestamp to an immutable
+// segment file, the later ones stay buffered for the next commit, and
+// a background thread merges the segments in tiers: whenever a level has c_iMergeFactor
+// segments, they are merged into one on the next level. Existing segments are picked up on
+// startup, restoring the state of the latest commit.
+class CIXInvertedIndex : public IIXIndexing, public IIXQuery, public CLifeReporterAgent< CIXInvertedIndex >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXInvertedIndex > SHP;
+
+    // Number of segments merged at once.
+    static const int c_iMergeFactor = 4;
+
+    // Constructor for an index held in memory.
+    CIXInvertedIndex()
+        : m_iItemsIndexed( 0 ), m_iItemsCommitted( 0 ), m_iNextGeneration( 0 ),
+          m_bStop( false ), m_bMergeRequested( false )
+    {
+    }
+
+    // Factory method for an index persisted to the specified directory.
+    static SHP Create( const string& szDirectory )
+    {
+        // Pick up the existing segments.
+        SHP shp( new CIXInvertedIndex() );
+        if( shp->Open( szDirectory ) == false )
+            return SHP();
+        return shp;
+    }
+
+    // Destructor.
+    virtual ~CIXInvertedIndex()
+    {
+        // Stop the merging.
+        if( m_threadMerge.joinable() )
+        {
+            {
+                lock_guard< mutex > lock( m_mutexMerge );
+                m_bStop = true;
+            }
+            m_cvMerge.notify_all();
+            m_threadMerge.join();
+
+        }  // end if
+
+        // Summary, including the sealed buffers and the segments. They may share values, which are counted once.
+        size_t stValues = m_table.GetValueCount();
+        size_t stBytes = m_table.GetBytes();
+        if( m_szDirectory.empty() == false )
+        {
+            vector< uint64_t > vecValues;
+            auto add = [ &vecValues ]( int iField, int iValue )
+                    { vecValues.push_back( static_cast< uint64_t >( iField ) << 32 | static_cast< uint32_t >( iValue ) ); };
+            m_table.ForEach( [ &add ]( const CIXPostingTable::Slot& slot, const CIXPostingList& ) { add( slot.m_iField, slot.m_iValue ); } );  // void
+            for( const Sealed& sealed : m_vecSealed )
+            {
+                sealed.m_shpTable->ForEach( [ &add ]( const CIXPostingTable::Slot& slot, const CIXPostingList& ) { add( slot.m_iField, slot.m_iValue ); } );  // void
+                stBytes += sealed.m_shpTable->GetBytes();
+            }
+            for( const CIXSegment::SHP& shpSegment : m_vecSegments )
+            {
+                shpSegment->ForEachValue( add );  // Return value ignored.
+                stBytes += shpSegment->GetPostingBytes();
+            }
+            sort( vecValues.begin(), vecValues.end() );
+            stValues = static_cast< size_t >( unique( vecValues.begin(), vecValues.end() ) - vecValues.begin() );
+
+        }  // end if
+        IX_LOG( Info, endl << "Indexed " << m_iItemsIndexed << " items under " << stValues <<
+                " values in " << stBytes << " bytes of postings, " << m_iItemsCommitted <<
+                " items committed at ts( " << m_ltCommitted.Get() << " )" <<
+                ( m_szDirectory.empty() ? string() : " into " + to_string( m_vecSegments.size() ) + " segments" ) << "." );
+    }
+
+// IIXQuery
+public:
+
+    // Finds the timestamps within the specified inclusive range of the items whose specified field
+    // has the specified value.
+    virtual void Lookup( int iField, int iValue, const CLogicalTimestamp& ltFrom, const CLogicalTimestamp& ltTo,
+            OUT vector< CLogicalTimestamp >& vecTimestamps ) const override
+    {
+        // Collect the postings of the buffer up to the sealed timestamp.
+        vector< int > vecFound;
+        auto collect = [ &vecFound ]( int iTimestamp ) { vecFound.push_back( iTimestamp ); };
+        uint32_t uKey = CIXKeyKernels::DeriveKey( iField, iValue );
+        vector< CIXSegment::SHP > vecSegments;
+        vector< Sealed > vecSealed;
+        {
+            shared_lock< shared_mutex > lock( m_mutex );
+            const CIXPostingList* pList = m_table.Find( iField, iValue, uKey );
+            if( pList )
+                pList->Scan( ltFrom.Get(), std::min( ltTo.Get(), m_ltCommitted.Get() ), collect );  // void
+            vecSegments = m_vecSegments;
+            vecSealed = m_vecSealed;
+        }
+
+        // The sealed buffers and the segments are immutable, so they are read without the lock.
+        for( const Sealed& sealed : vecSealed )
+        {
+            const CIXPostingList* pList = sealed.m_shpTable->Find( iField, iValue, uKey );
+            if( pList )
+                pList->Scan( ltFrom.Get(), ltTo.Get(), collect );  // void
+        }
+        for( const CIXSegment::SHP& shpSegment : vecSegments )
+            shpSegment->Scan( iField, iValue, uKey, ltFrom.Get(), ltTo.Get(), collect );  // Return value ignored.
+
+        // A merge interrupted by a crash may leave duplicates behind.
+        sort( vecFound.begin(), vecFound.end() );
+        vecFound.erase( unique( vecFound.begin(), vecFound.end() ), vecFound.end() );
+        vecTimestamps.assign( vecFound.begin(), vecFound.end() );
+    }
+
+    // Finds the items within the specified inclusive timestamp range, in timestamp order.
+    virtual void ScanRange( const CLogicalTimestamp& ltFrom, const CLogicalTimestamp& ltTo, OUT vector< CIXItem >& vecItems ) const override
+    {
+        // Collect the items of the buffer up to the sealed timestamp.
+        vector< CIXItemStore::Record > vecFound;
+        auto collect = [ &vecFound ]( const CIXItemStore::Record& record ) { vecFound.push_back( record ); };
+        vector< CIXSegment::SHP > vecSegments;
+        vector< Sealed > vecSealed;
+        {
+            shared_lock< shared_mutex > lock( m_mutex );
+            m_items.Scan( ltFrom.Get(), std::min( ltTo.Get(), m_ltCommitted.Get() ), collect );  // void
+            vecSegments = m_vecSegments;
+            vecSealed = m_vecSealed;
+        }
+
+        // The sealed buffers and the segments are immutable, so they are read without the lock.
+        for( const Sealed& sealed : vecSealed )
+            sealed.m_shpItems->Scan( ltFrom.Get(), ltTo.Get(), collect );  // void
+        for( const CIXSegment::SHP& shpSegment : vecSegments )
+            shpSegment->ScanItems( ltFrom.Get(), ltTo.Get(), collect );  // Return value ignored.
+
+        // Order and drop the duplicates.
+        sort( vecFound.begin(), vecFound.end(), CIXSegment::IsRecordBefore );
+        vecFound.erase( unique( vecFound.begin(), vecFound.end(), []( const CIXItemStore::Record& a, const CIXItemStore::Record& b )
+                { return CIXSegment::IsRecordBefore( a, b ) == false && CIXSegment::IsRecordBefore( b, a ) == false; } ), vecFound.end() );
+        vecItems.clear();
+        vecItems.reserve( vecFound.size() );
+        for( const CIXItemStore::Record& record : vecFound )
+            vecItems.push_back( CIXItem( record.m_i, record.m_j, record.m_k, CLogicalTimestamp( record.m_iTimestamp ) ) );
+    }
+
+    // Finds the items of the specified timestamp.
+    virtual void LookupTimestamp( const CLogicalTimestamp& lt, OUT vector< CIXItem >& vecItems ) const override
+    {
+        // Delegate.
+        ScanRange( lt, lt, OUT vecItems );  // void
+    }
+
+    // Gets the timestamp of the latest commit.
+    virtual CLogicalTimestamp GetCommitted() const override
+    {
+        shared_lock< shared_mutex > lock( m_mutex );
+        return m_ltCommitted;
+    }
+
+// IIXIndexing
+public:
+
+    // Indexes data.
+    virtual bool Index( const CIXItem& item ) override
+    {
+        // Delegate.
+        return IndexBatch( span< const CIXItem >( &item, 1 ) );
+    }
+
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > items ) override
+    {
+        // Derive the keys one by one.
+        unique_lock< shared_mutex > lock( m_mutex );
+        for( const CIXItem& item : items )
+        {
+            int rgiValues[ CIXPreparedData::c_iFields ] = { item.GetI(), item.GetJ(), item.GetK() };
+            for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+                m_table.Add( iField, rgiValues[ iField ], CIXKeyKernels::DeriveKey( iField, rgiValues[ iField ] ),
+                        item.AccessLT().Get() );  // void
+            m_items.Append( item.GetI(), item.GetJ(), item.GetK(), item.AccessLT().Get() );  // void
+
+        }  // end for
+        m_iItemsIndexed += static_cast< int >( items.size() );
+        return true;
+    }
+
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& columns ) override
+    {
+        // Grow the table up front so that the buckets derived for the whole batch stay valid.
+        unique_lock< shared_mutex > lock( m_mutex );
+        size_t stCount = columns.GetSize();
+        m_table.Reserve( m_table.GetValueCount() + stCount * CIXPreparedData::c_iFields );  // void
+
+        // Derive the keys and buckets of each field at once and insert.
+        const int* rgpiValues[ CIXPreparedData::c_iFields ] = { columns.AccessI(), columns.AccessJ(), columns.AccessK() };
+        for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+        {
+            m_vecKeys.resize( stCount );
+            m_vecBuckets.resize( stCount );
+            CIXKeyKernels::Derive( iField, rgpiValues[ iField ], stCount, m_table.GetBucketMask(),
+                    OUT m_vecKeys.data(), OUT m_vecBuckets.data() );  // void
+            for( size_t stItem = 0; stItem < stCount; stItem++ )
+                m_table.AddAt( m_vecBuckets[ stItem ], iField, rgpiValues[ iField ][ stItem ], m_vecKeys[ stItem ],
+                        columns.AccessTimestamps()[ stItem ] );  // void
+
+        }  // end for
+        for( size_t stItem = 0; stItem < stCount; stItem++ )
+            m_items.Append( columns.AccessI()[ stItem ], columns.AccessJ()[ stItem ], columns.AccessK()[ stItem ],
+                    columns.AccessTimestamps()[ stItem ] );  // void
+        m_iItemsIndexed += static_cast< int >( stCount );
+        return true;
+    }
+
+    // Indexes a batch of prepared data.
+    virtual bool IndexPrepared( span< const CIXPreparedData > data ) override
+    {
+        // Use the derived keys.
+        unique_lock< shared_mutex > lock( m_mutex );
+        for( const CIXPreparedData& prepared : data )
+        {
+            const CIXItem& item = prepared.AccessItem();
+            int rgiValues[ CIXPreparedData::c_iFields ] = { item.GetI(), item.GetJ(), item.GetK() };
+            for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+                m_table.Add( iField, rgiValues[ iField ], prepared.GetKey( iField ), item.AccessLT().Get() );  // void
+            m_items.Append( item.GetI(), item.GetJ(), item.GetK(), item.AccessLT().Get() );  // void
+
+        }  // end for
+        m_iItemsIndexed += static_cast< int >( data.size() );
+        return true;
+    }
+
+    // Commits the current state. The items indexed so far become visible to the queries and,
+    // with a directory, are flushed to a new segment.
+    virtual bool Commit( const CLogicalTimestamp& lt, int ) override
+    {
+        // Seal the buffer.
+        lock_guard< mutex > lockCommit( m_mutexCommit );
+        vector< Sealed > vecSealed;
+        {
+            unique_lock< shared_mutex > lock( m_mutex );
+            int iPrevious = m_ltCommitted.Get();
+            if( lt.IsLaterThan( m_ltCommitted ) )
+            {
+                // Count the items the commit covers. Later ones may have been indexed already,
+                // e.g. by the shards ahead of the low watermark.
+                m_items.Scan( m_ltCommitted.Get() + 1, lt.Get(), [ this ]( const CIXItemStore::Record& ) { m_iItemsCommitted++; } );  // void
+                m_ltCommitted = lt;
+
+            }  // end if
+            if( m_szDirectory.empty() )
+                return true;
+
+            // Hand the newly committed part of the buffer over to the flushing, together with any
+            // earlier ones whose flush failed.
+            shared_ptr< CIXPostingTable > shpTable = make_shared< CIXPostingTable >();
+            shared_ptr< CIXItemStore > shpItems = make_shared< CIXItemStore >();
+            SplitBuffer( iPrevious, m_ltCommitted.Get(), OUT *shpTable, OUT *shpItems );  // void
+            if( shpItems->GetCount() > 0 )
+                m_vecSealed.push_back( Sealed{ shpTable, shpItems, m_ltCommitted } );
+            vecSealed = m_vecSealed;
+        }
+
+        // Write the segments without holding the lock. The sealed tables stay queryable meanwhile.
+        bool bSuccess = true;
+        for( const Sealed& sealed : vecSealed )
+        {
+            // Write.
+            int iGeneration = m_iNextGeneration.fetch_add( 1 );
+            string szPath = ( filesystem::path( m_szDirectory ) / CIXSegment::GetFileName( iGeneration, 0, sealed.m_lt,
+                    sealed.m_shpItems->GetCount() ) ).string();
+            if( CIXSegment::Write( *sealed.m_shpTable, *sealed.m_shpItems, szPath, sealed.m_lt ) == false )
+            {
+                bSuccess = false;
+                break;
+
+            }  // end if
+
+            // Replace the sealed table by the segment.
+            unique_lock< shared_mutex > lock( m_mutex );
+            m_vecSegments.push_back( make_shared< CIXSegment >( szPath, iGeneration, 0, sealed.m_lt, sealed.m_shpItems->GetCount() ) );
+            m_vecSealed.erase( m_vecSealed.begin() );
+
+        }  // end for
+
+        // Have the new segments merged as necessary.
+        RequestMerge();  // void
+        return bSuccess;
+    }
+
+private:
+
+    // Sealed buffer waiting to be flushed.
+    struct Sealed
+    {
+        shared_ptr< const CIXPostingTable > m_shpTable;  // Values.
+        shared_ptr< const CIXItemStore > m_shpItems;  // Items.
+        CLogicalTimestamp m_lt;  // Commit timestamp.
+    };
+
+    // Moves the buffered items after the first and up to the second timestamp to the specified
+    // table and store. The earlier items were committed before and are indexed again only after a
+    // restart or a rewind, so they are dropped. The later items stay buffered.
+    void SplitBuffer( int iFrom, int iTo, OUT CIXPostingTable& table, OUT CIXItemStore& items )
+    {
+        // Usually every item is within the range, and the whole buffer goes.
+        if( m_items.GetEarliest() > iFrom && m_items.GetLatest() <= iTo )
+        {
+            table = std::move( m_table );
+            items = std::move( m_items );
+            m_table = CIXPostingTable();
+            m_items = CIXItemStore();
+            return;
+
+        }  // end if
+
+        // Otherwise distribute the items in their arrival order, which keeps the posting lists ordered alike.
+        CIXPostingTable tableLater;
+        CIXItemStore itemsLater;
+        for( const CIXItemStore::Record& record : m_items.AccessRecords() )
+        {
+            if( record.m_iTimestamp <= iFrom )
+                continue;
+            bool bCommitted = record.m_iTimestamp <= iTo;
+            CIXPostingTable& tableTo = bCommitted ? table : tableLater;
+            int rgiValues[ CIXPreparedData::c_iFields ] = { record.m_i, record.m_j, record.m_k };
+            for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+                tableTo.Add( iField, rgiValues[ iField ], CIXKeyKernels::DeriveKey( iField, rgiValues[ iField ] ), record.m_iTimestamp );  // void
+            ( bCommitted ? items : itemsLater ).Append( record.m_i, record.m_j, record.m_k, record.m_iTimestamp );  // void
+
+        }  // end for
+        m_table = std::move( tableLater );
+        m_items = std::move( itemsLater );
+    }
+
+    // Picks up the segments of the specified directory and starts the merging.
+    bool Open( const string& szDirectory )
+    {
+        // Make sure the directory exists.
+        error_code ec;
+        filesystem::create_directories( szDirectory, ec );  // Return value ignored.
+        if( filesystem::is_directory( szDirectory, ec ) == false )
+            return false;
+        m_szDirectory = szDirectory;
+
+        // Collect the segments without mapping them. Left-overs of interrupted writes are removed.
+        int iMaxGeneration = -1;
+        for( const filesystem::directory_entry& entry : filesystem::directory_iterator( szDirectory, ec ) )
+        {
+            string szName = entry.path().filename().string();
+            int iGeneration = 0;
+            int iLevel = 0;
+            CLogicalTimestamp ltCommitted;
+            size_t stItems = 0;
+            if( CIXSegment::ParseFileName( szName, OUT iGeneration, OUT iLevel, OUT ltCommitted, OUT stItems ) )
+            {
+                m_vecSegments.push_back( make_shared< CIXSegment >( entry.path().string(), iGeneration, iLevel, ltCommitted, stItems ) );
+                iMaxGeneration = std::max( iMaxGeneration, iGeneration );
+            }
+            else if( entry.path().extension() == ".tmp" )
+                filesystem::remove( entry.path(), ec );  // Return value ignored.
+
+        }  // end for
+        if( ec )
+            return false;
+        m_iNextGeneration.store( iMaxGeneration + 1 );
+
+        // Restore the state of the latest commit from the names of the segments.
+        for( const CIXSegment::SHP& shpSegment : m_vecSegments )
+        {
+            m_ltCommitted.UpdateIfLater( shpSegment->AccessCommitted() );  // void
+            m_iItemsCommitted += static_cast< int >( shpSegment->GetItemCount() );
+
+        }  // end for
+
+        // Start the merging.
+        m_threadMerge = thread( &CIXInvertedIndex::MergeWorker, this );
+        RequestMerge();  // void
+        return true;
+    }
+
+    // Wakes up the merging.
+    void RequestMerge()
+    {
+        if( m_threadMerge.joinable() == false )
+            return;
+        {
+            lock_guard< mutex > lock( m_mutexMerge );
+            m_bMergeRequested = true;
+        }
+        m_cvMerge.notify_all();
+    }
+
+    // Background thread merging the segments.
+    void MergeWorker()
+    {
+        // Merge whenever requested until stopped.
+        unique_lock< mutex > lock( m_mutexMerge );
+        while( true )
+        {
+            m_cvMerge.wait( lock, [ this ] { return m_bStop || m_bMergeRequested; } );
+            if( m_bStop )
+                break;
+            m_bMergeRequested = false;
+
+            // Merge without holding the lock while there is something to merge.
+            lock.unlock();
+            bool bMerged = true;
+            while( bMerged && m_bStop.load() == false )
+                bMerged = MergeOnce();
+            lock.lock();
+
+        }  // end while
+    }
+
+    // Merges the oldest segments of the lowest level which has enough of them. Returns false
+    // if there is nothing to merge or the merge fails.
+    bool MergeOnce()
+    {
+        // Pick the inputs.
+        vector< CIXSegment::SHP > vecInputs;
+        {
+            shared_lock< shared_mutex > lock( m_mutex );
+            map< int, vector< CIXSegment::SHP > > mapLevels;
+            for( const CIXSegment::SHP& shpSegment : m_vecSegments )
+                mapLevels[ shpSegment->GetLevel() ].push_back( shpSegment );
+            for( auto& p : mapLevels )
+            {
+                if( p.second.size() < static_cast< size_t >( c_iMergeFactor ) )
+                    continue;
+                sort( p.second.begin(), p.second.end(), []( const CIXSegment::SHP& a, const CIXSegment::SHP& b )
+                        { return a->GetGeneration() < b->GetGeneration(); } );
+                vecInputs.assign( p.second.begin(), p.second.begin() + c_iMergeFactor );
+                break;
+
+            }  // end for
+        }
+        if( vecInputs.empty() )
+            return false;
+
+        // Merge.
+        CLogicalTimestamp ltCommitted;
+        size_t stItems = 0;
+        for( const CIXSegment::SHP& shpInput : vecInputs )
+        {
+            ltCommitted.UpdateIfLater( shpInput->AccessCommitted() );  // void
+            stItems += shpInput->GetItemCount();
+        }
+        int iLevel = vecInputs.front()->GetLevel() + 1;
+        int iGeneration = m_iNextGeneration.fetch_add( 1 );
+        string szPath = ( filesystem::path( m_szDirectory ) / CIXSegment::GetFileName( iGeneration, iLevel, ltCommitted, stItems ) ).string();
+        if( CIXSegment::Merge( vecInputs, szPath, iLevel ) == false )
+            return false;
+
+        // Replace the inputs. Their files go when the queries in progress release them.
+        {
+            unique_lock< shared_mutex > lock( m_mutex );
+            for( const CIXSegment::SHP& shpInput : vecInputs )
+                m_vecSegments.erase( find( m_vecSegments.begin(), m_vecSegments.end(), shpInput ) );
+            m_vecSegments.push_back( make_shared< CIXSegment >( szPath, iGeneration, iLevel, ltCommitted, stItems ) );
+        }
+        for( const CIXSegment::SHP& shpInput : vecInputs )
+            shpInput->MarkObsolete();  // void
+        return true;
+    }
+
+private:
+    mutable shared_mutex m_mutex;  // Guards the state against concurrent queries, commits and merges.
+    mutex m_mutexCommit;  // Serializes the commits.
+    CIXPostingTable m_table;  // Values of the items not flushed yet, or of all of them without a directory.
+    CIXItemStore m_items;  // Items not flushed yet, or all of them without a directory.
+    CIXKeyKernels::Keys m_vecKeys;  // Keys of a columnar batch.
+    CIXKeyKernels::Keys m_vecBuckets;  // Buckets of a columnar batch.
+    CLogicalTimestamp m_ltCommitted;  // Timestamp of the latest commit.
+    int m_iItemsIndexed;  // Number of indexed items.
+    int m_iItemsCommitted;  // Number of items up to the timestamp of the latest commit.
+    string m_szDirectory;  // Segment directory, if any.
+    vector< Sealed > m_vecSealed;  // Sealed buffers waiting to be flushed, oldest first.
+    vector< CIXSegment::SHP > m_vecSegments;  // Segments.
+    atomic< int > m_iNextGeneration;  // Generation of the next segment.
+    thread m_threadMerge;  // Merging thread.
+    mutex m_mutexMerge;  // Guards the merge requests.
+    condition_variable m_cvMerge;  // Signals the merge requests.
+    atomic< bool > m_bStop;  // Indicates whether the merging should stop.
+    bool m_bMergeRequested;  // Indicates whether the segments have changed.
+};
+
+// Histogram of non-negative values with a bounded relative error, in the manner of HDR histograms.
+// Each power of two is split into c_iSubBuckets linear buckets, so a value is placed with a few
+// bit operations and recorded with relaxed atomic increments. Safe to record from many threads.
+class CIXHistogram
+{
+public:
+
+    // Constructor.
+    CIXHistogram()
+        : m_uCount( 0 ), m_uSum( 0 ), m_uMax( 0 )
+    {
+    }
+
+    // Records a value the specified number of times.
+    void Record( uint64_t uValue, uint64_t uCount = 1 )
+    {
+        // Count.
+        m_rguCounts[ GetBucket( uValue ) ].fetch_add( uCount, memory_order_relaxed );  // Return value ignored.
+        m_uCount.fetch_add( uCount, memory_order_relaxed );  // Return value ignored.
+        m_uSum.fetch_add( uValue * uCount, memory_order_relaxed );  // Return value ignored.
+
+        // Track the maximum.
+        uint64_t uMax = m_uMax.load( memory_order_relaxed );
+        while( uValue > uMax && m_uMax.compare_exchange_weak( uMax, uValue, memory_order_relaxed ) == false )
+        {
+        }
+    }
+
+    // Returns the number of values recorded.
+    uint64_t GetCount() const { return m_uCount.load( memory_order_relaxed ); }
+
+    // Returns the sum of the values recorded.
+    uint64_t GetSum() const { return m_uSum.load( memory_order_relaxed ); }
+
+    // Returns the value below which the specified portion of the values fall, within the bucket precision.
+    uint64_t GetPercentile( double dPortion ) const
+    {
+        // Find the bucket reaching the rank.
+        uint64_t uRank = static_cast< uint64_t >( dPortion * static_cast< double >( GetCount() ) + 0.5 );
+        uint64_t uSeen = 0;
+        for( int iBucket = 0; iBucket < c_iBuckets; iBucket++ )
+        {
+            uSeen += m_rguCounts[ iBucket ].load( memory_order_relaxed );
+            if( uSeen > 0 && uSeen >= uRank )
+                return std::min( GetBucketHigh( iBucket ), m_uMax.load( memory_order_relaxed ) );
+
+        }  // end for
+        return m_uMax.load( memory_order_relaxed );
+    }
+
+    // Returns the number of values recorded up to the specified bound, within the bucket precision.
+    uint64_t GetCountUpTo( uint64_t uBound ) const
+    {
+        // Sum up the buckets below the bound.
+        uint64_t uCount = 0;
+        for( int iBucket = 0; iBucket < c_iBuckets && GetBucketHigh( iBucket ) <= uBound; iBucket++ )
+            uCount += m_rguCounts[ iBucket ].load( memory_order_relaxed );
+        return uCount;
+    }
+
+private:
+
+    // Returns the bucket of the value.
+    static int GetBucket( uint64_t uValue )
+    {
+        // The smallest values have a bucket each.
+        if( uValue < c_iSubBuckets )
+            return static_cast< int >( uValue );
+        int iExponent = static_cast< int >( bit_width( uValue ) ) - 1;
+        return ( iExponent - c_iSubBits + 1 ) * c_iSubBuckets +
+                static_cast< int >( ( uValue >> ( iExponent - c_iSubBits ) ) & ( c_iSubBuckets - 1 ) );
+    }
+
+    // Returns the highest value of the bucket.
+    static uint64_t GetBucketHigh( int iBucket )
+    {
+        // The smallest values have a bucket each.
+        if( iBucket < c_iSubBuckets )
+            return static_cast< uint64_t >( iBucket );
+        int iShift = iBucket / c_iSubBuckets - 1;
+        uint64_t uLow = static_cast< uint64_t >( c_iSubBuckets + iBucket % c_iSubBuckets ) << iShift;
+        return uLow + ( ( uint64_t( 1 ) << iShift ) - 1 );
+    }
+
+private:
+    static const int c_iSubBits = 4;  // Bits of the linear buckets within a power of two.
+    static const int c_iSubBuckets = 1 << c_iSubBits;  // Linear buckets within a power of two.
+    static const int c_iBuckets = ( 64 - c_iSubBits + 1 ) * c_iSubBuckets;  // Buckets for all 64-bit values.
+    atomic< uint64_t > m_rguCounts[ c_iBuckets ];  // Counts by bucket.
+    atomic< uint64_t > m_uCount;  // Number of values.
+    atomic< uint64_t > m_uSum;  // Sum of values.
+    atomic< uint64_t > m_uMax;  // Maximum value.
+};
+
+// Monitor interface.
+class IIXMonitor
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXMonitor > SHP;
+
+    // Records the retrieval of a chunk.
+    virtual void RecordChunk( chrono::nanoseconds nsElapsed, int iRequested, int iReceived ) = 0;
+
+    // Indicates whether the next indexing call should be timed.
+    virtual bool IsIndexingSampled() = 0;
+
+    // Records a timed indexing call of the specified number of items.
+    virtual void RecordIndexing( chrono::nanoseconds nsElapsed, int iItems ) = 0;
+
+    // Records the start of a batch.
+    virtual void RecordPreBatch() = 0;
+
+    // Records the commit of a batch.
+    virtual void RecordPostBatch( chrono::nanoseconds nsCommit, int iItems ) = 0;
+
+    // Destructor.
+    virtual ~IIXMonitor()
+    {
+    }
+};
+
+// Monitor collecting the latencies and sizes into histograms and relaying snapshots of them to a
+// file in the Prometheus text format, for example for the textfile collector of the node exporter.
+// The snapshot is written after a commit at most once per interval, and when requested.
+class CIXMonitorRelay : public IIXMonitor, public CLifeReporterAgent< CIXMonitorRelay >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXMonitorRelay > SHP;
+
+    // Constructor.
+    CIXMonitorRelay( const string& szPath, chrono::milliseconds msInterval = chrono::milliseconds( 1000 ) )
+        : m_szPath( szPath ), m_msInterval( msInterval ), m_tpLastExport( chrono::steady_clock::now() ),
+          m_uChunks( 0 ), m_uEmptyChunks( 0 ), m_uItemsRequested( 0 ), m_uItemsReceived( 0 ), m_uBatches( 0 )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXMonitorRelay()
+    {
+    }
+
+// IIXMonitor
+public:
+
+    // Records the retrieval of a chunk.
+    virtual void RecordChunk( chrono::nanoseconds nsElapsed, int iRequested, int iReceived ) override
+    {
+        // Latency, emptiness and fill.
+        m_histRetrieval.Record( static_cast< uint64_t >( nsElapsed.count() ) );  // void
+        m_uChunks.fetch_add( 1, memory_order_relaxed );  // Return value ignored.
+        if( iReceived == 0 )
+            m_uEmptyChunks.fetch_add( 1, memory_order_relaxed );  // Return value ignored.
+        m_uItemsRequested.fetch_add( static_cast< uint64_t >( std::max( 0, iRequested ) ), memory_order_relaxed );  // Return value ignored.
+        m_uItemsReceived.fetch_add( static_cast< uint64_t >( std::max( 0, iReceived ) ), memory_order_relaxed );  // Return value ignored.
+    }
+
+    // Indicates whether the next indexing call should be timed.
+    virtual bool IsIndexingSampled() override
+    {
+        // Every c_uSamplePeriod call of each thread.
+        thread_local uint32_t uCalls = 0;
+        return ++uCalls % c_uSamplePeriod == 0;
+    }
+
+    // Records a timed indexing call of the specified number of items.
+    virtual void RecordIndexing( chrono::nanoseconds nsElapsed, int iItems ) override
+    {
+        // Per item.
+        if( iItems > 0 )
+            m_histIndexing.Record( static_cast< uint64_t >( nsElapsed.count() ) / iItems, iItems );  // void
+    }
+
+    // Records the start of a batch.
+    virtual void RecordPreBatch() override
+    {
+        // Count.
+        m_uBatches.fetch_add( 1, memory_order_relaxed );  // Return value ignored.
+    }
+
+    // Records the commit of a batch.
+    virtual void RecordPostBatch( chrono::nanoseconds nsCommit, int iItems ) override
+    {
+        // Latency and size.
+        m_histCommit.Record( static_cast< uint64_t >( nsCommit.count() ) );  // void
+        m_histBatchItems.Record( static_cast< uint64_t >( std::max( 0, iItems ) ) );  // void
+
+        // Relay a snapshot once the interval has passed, unless another thread is doing it.
+        unique_lock< mutex > lock( m_mutexExport, try_to_lock );
+        if( lock.owns_lock() && chrono::steady_clock::now() - m_tpLastExport >= m_msInterval )
+            ExportLocked();  // Return value ignored.
+    }
+
+public:
+
+    // Writes a snapshot in the Prometheus text format.
+    void WritePrometheus( ostream& os ) const
+    {
+        // Latencies in seconds from a microsecond to ten seconds, and batch sizes in powers of two.
+        vector< double > vecLatencyBounds;
+        for( double dDecade = 1e-6; dDecade < 10.0; dDecade *= 10.0 )
+        {
+            vecLatencyBounds.push_back( dDecade );
+            vecLatencyBounds.push_back( dDecade * 2.5 );
+            vecLatencyBounds.push_back( dDecade * 5.0 );
+
+        }  // end for
+        vector< double > vecSizeBounds;
+        for( double dSize = 1.0; dSize <= 65536.0; dSize *= 2.0 )
+            vecSizeBounds.push_back( dSize );
+
+        // Histograms and counters.
+        WriteHistogram( os, "ix_retrieval_seconds", "Latency of retrieving a chunk.", m_histRetrieval, 1e-9, vecLatencyBounds );  // void
+        WriteHistogram( os, "ix_index_item_seconds", "Latency of indexing an item, sampled.", m_histIndexing, 1e-9, vecLatencyBounds );  // void
+        WriteHistogram( os, "ix_commit_seconds", "Latency of committing a batch.", m_histCommit, 1e-9, vecLatencyBounds );  // void
+        WriteHistogram( os, "ix_batch_items", "Items per batch.", m_histBatchItems, 1.0, vecSizeBounds );  // void
+        WriteCounter( os, "ix_chunks_total", "Chunks retrieved.", m_uChunks.load( memory_order_relaxed ) );  // void
+        WriteCounter( os, "ix_empty_chunks_total", "Chunks retrieved without items.", m_uEmptyChunks.load( memory_order_relaxed ) );  // void
+        WriteCounter( os, "ix_requested_items_total", "Items requested by the chunk retrievals.", m_uItemsRequested.load( memory_order_relaxed ) );  // void
+        WriteCounter( os, "ix_received_items_total", "Items received by the chunk retrievals.", m_uItemsReceived.load( memory_order_relaxed ) );  // void
+        WriteCounter( os, "ix_batches_total", "Batches started.", m_uBatches.load( memory_order_relaxed ) );  // void
+    }
+
+    // Writes a snapshot to the file. The file is replaced as a whole, so readers never see a partial one.
+    bool Export()
+    {
+        lock_guard< mutex > lock( m_mutexExport );
+        return ExportLocked();
+    }
+
+    // Logs a summary of the latencies.
+    void LogSummary() const
+    {
+        IX_LOG( Info, "Retrieval per chunk " << FormatPercentiles( m_histRetrieval ) <<
+                ", indexing per item " << FormatPercentiles( m_histIndexing ) <<
+                ", commit per batch " << FormatPercentiles( m_histCommit ) << ", " <<
+                m_uEmptyChunks.load( memory_order_relaxed ) << " of " << m_uChunks.load( memory_order_relaxed ) << " chunks empty." );
+    }
+
+private:
+
+    // Writes a snapshot to the file while holding the lock.
+    bool ExportLocked()
+    {
+        // Write aside and replace.
+        m_tpLastExport = chrono::steady_clock::now();
+        string szTemporary = m_szPath + ".tmp";
+        {
+            ofstream ofs( szTemporary, ios::trunc );
+            WritePrometheus( ofs );  // void
+            if( ofs.flush().good() == false )
+                return false;
+        }
+        error_code ec;
+        filesystem::rename( szTemporary, m_szPath, ec );  // void
+        return ! ec;
+    }
+
+    // Writes a histogram in the Prometheus text format. The values are scaled to the unit of the bounds.
+    static void WriteHistogram( ostream& os, const char* pszName, const char* pszHelp, const CIXHistogram& hist,
+            double dScale, const vector< double >& vecBounds )
+    {
+        os << "# HELP " << pszName << " " << pszHelp << "\n" << "# TYPE " << pszName << " histogram\n";
+        for( double dBound : vecBounds )
+            os << pszName << "_bucket{le=\"" << dBound << "\"} " <<
+                    hist.GetCountUpTo( static_cast< uint64_t >( dBound / dScale + 0.5 ) ) << "\n";
+        os << pszName << "_bucket{le=\"+Inf\"} " << hist.GetCount() << "\n";
+        os << pszName << "_sum " << static_cast< double >( hist.GetSum() ) * dScale << "\n";
+        os << pszName << "_count " << hist.GetCount() << "\n";
+    }
+
+    // Writes a counter in the Prometheus text format.
+    static void WriteCounter( ostream& os, const char* pszName, const char* pszHelp, uint64_t uValue )
+    {
+        os << "# HELP " << pszName << " " << pszHelp << "\n" << "# TYPE " << pszName << " counter\n";
+        os << pszName << " " << uValue << "\n";
+    }
+
+    // Formats the median and the 99th percentile of nanosecond latencies in microseconds.
+    static string FormatPercentiles( const CIXHistogram& hist )
+    {
+        ostringstream oss;
+        oss << "p50 " << static_cast< double >( hist.GetPercentile( 0.5 ) ) / 1000.0 << " us, p99 " <<
+                static_cast< double >( hist.GetPercentile( 0.99 ) ) / 1000.0 << " us";
+        return oss.str();
+    }
+
+private:
+    static const uint32_t c_uSamplePeriod = 16;  // Indexing calls per timed call.
+    string m_szPath;  // Path of the snapshot file.
+    chrono::milliseconds m_msInterval;  // Minimum interval of the snapshots relayed after commits.
+    mutex m_mutexExport;  // Serializes the snapshots.
+    chrono::steady_clock::time_point m_tpLastExport;  // Time of the latest snapshot.
+    CIXHistogram m_histRetrieval;  // Retrieval latencies per chunk, in nanoseconds.
+    CIXHistogram m_histIndexing;  // Indexing latencies per item, in nanoseconds.
+    CIXHistogram m_histCommit;  // Commit latencies per batch, in nanoseconds.
+    CIXHistogram m_histBatchItems;  // Items per batch.
+    atomic< uint64_t > m_uChunks;  // Chunks retrieved.
+    atomic< uint64_t > m_uEmptyChunks;  // Chunks retrieved without items.
+    atomic< uint64_t > m_uItemsRequested;  // Items requested by the chunk retrievals.
+    atomic< uint64_t > m_uItemsReceived;  // Items received by the chunk retrievals.
+    atomic< uint64_t > m_uBatches;  // Batches started.
+};
+
+// Callback interface.
+class IIXCallback
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXCallback > SHP;
+
+    // Returns the batch size.
+    virtual int GetBatchSize() = 0;
+
+    // Returns the chunk size.
+    virtual int GetChunkSize() = 0;
+
+    // Indicates whether the chunks are held column by column.
+    virtual bool IsColumnar() = 0;
+
+    // Accesses the latest seen timestamp.
+    virtual const CLogicalTimestamp& AccessLatestSeen() const = 0;
+
+    // Updates the locally stored timestamp if the provided one is later.
+    virtual void UpdateIfLater( const CLogicalTimestamp& ltProvided ) = 0;
+
+    // Accesses the data retrieval.
+    virtual const IIXDataRetrieval::SHP AccessDataRetrieval() = 0;
+
+    // Accesses the indexing engine.
+    virtual const IIXIndexing::SHP AccessIndexing() = 0;
+
+    // Commits the progress of a batch.
+    virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) = 0;
+
+    // Gets the latest durably committed timestamp.
+    virtual CLogicalTimestamp GetDurable() const = 0;
+
+    // Waits for the commits completing in the background. Returns false if any of them failed.
+    virtual bool Flush() = 0;
+
+    // Records the outcome of a data retrieval.
+    virtual void RecordRetrieval( chrono::nanoseconds nsElapsed, int iRequested, int iReceived ) = 0;
+
+    // Records the outcome of a commit.
+    virtual void RecordCommit( chrono::nanoseconds nsElapsed, int iActualCount ) = 0;
+
+    // Accesses the monitor, if any.
+    virtual const IIXMonitor::SHP AccessMonitor() = 0;
+
+    // Destructor.
+    virtual ~IIXCallback()
+    {
+    }
+};
+
+// Background committer which folds consecutive commit requests into one.
+class CIXGroupCommitter : public CLifeReporterAgent< CIXGroupCommitter >
+{
+public:
+
+    // Helper types.
+    typedef function< bool( const CLogicalTimestamp& lt, int iActualCount ) > FnCommit;
+
+    // Constructor.
+    CIXGroupCommitter( FnCommit fnCommit )
+        : m_fnCommit( fnCommit ), m_bPending( false ), m_bInProgress( false ), m_bStop( false ),
+          m_bFailed( false ), m_iPendingCount( 0 )
+    {
+        // Start the background thread.
+        m_thread = thread( &CIXGroupCommitter::Worker, this );
+    }
+
+    // Destructor.
+    virtual ~CIXGroupCommitter()
+    {
+        // Complete the pending commits and stop. A failure is reported by an explicit Flush().
+        Flush();  // Return value ignored.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    // Queues a commit request. Returns false if an earlier commit failed, in which case the
+    // request is dropped, since the caller has to start again from the durable timestamp.
+    bool Enqueue( const CLogicalTimestamp& lt, int iActualCount )
+    {
+        // Report a failure, or fold the request into the pending one.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            if( m_bFailed )
+            {
+                m_bFailed = false;
+                return false;
+
+            }  // end if
+            m_ltPending.UpdateIfLater( lt );  // void
+            m_iPendingCount += iActualCount;
+            m_bPending = true;
+        }
+        m_cv.notify_all();
+        return true;
+    }
+
+    // Waits until all queued commits have been written. Returns false if a commit failed since
+    // the failure was last reported.
+    bool Flush()
+    {
+        unique_lock< mutex > lock( m_mutex );
+        m_cv.wait( lock, [ this ] { return m_bPending == false && m_bInProgress == false; } );
+        bool bFailed = m_bFailed;
+        m_bFailed = false;
+        return bFailed == false;
+    }
+
+    // Gets the latest durably committed timestamp.
+    CLogicalTimestamp GetDurable() const
+    {
+        lock_guard< mutex > lock( m_mutex );
+        return m_ltDurable;
+    }
+
+private:
+
+    // Background thread.
+    void Worker()
+    {
+        // Write the commits until stopped.
+        unique_lock< mutex > lock( m_mutex );
+        while( true )
+        {
+            // Wait for a request.
+            m_cv.wait( lock, [ this ] { return m_bStop || m_bPending; } );
+            if( m_bPending == false )
+                break;
+
+            // Take everything requested so far.
+            CLogicalTimestamp lt = m_ltPending;
+            int iCount = m_iPendingCount;
+            m_ltPending = CLogicalTimestamp();
+            m_iPendingCount = 0;
+            m_bPending = false;
+            m_bInProgress = true;
+
+            // Write without holding the lock so that new requests can pile up meanwhile.
+            lock.unlock();
+            bool bSuccess = false;
+            try
+            {
+                bSuccess = m_fnCommit( lt, iCount );
+            }
+            catch( const exception& )
+            {
+                bSuccess = false;
+            }
+            lock.lock();
+
+            // Publish the durable watermark. After a failure, the requests queued meanwhile are
+            // dropped, so that they cannot commit past the failed one.
+            if( bSuccess )
+                m_ltDurable.UpdateIfLater( lt );  // void
+            else
+            {
+                m_bFailed = true;
+                m_ltPending = CLogicalTimestamp();
+                m_iPendingCount = 0;
+                m_bPending = false;
+
+            }  // end if
+            m_bInProgress = false;
+            m_cv.notify_all();
+
+        }  // end while
+    }
+
+private:
+    FnCommit m_fnCommit;  // Actual commit.
+    mutable mutex m_mutex;  // Guards the state.
+    condition_variable m_cv;  // Signals state changes.
+    thread m_thread;  // Background thread.
+    bool m_bPending;  // Indicates a pending request.
+    bool m_bInProgress;  // Indicates a commit being written.
+    bool m_bStop;  // Indicates whether the background thread should stop.
+    bool m_bFailed;  // Indicates an unreported failure.
+    CLogicalTimestamp m_ltPending;  // Pending commit timestamp.
+    int m_iPendingCount;  // Pending commit item count.
+    CLogicalTimestamp m_ltDurable;  // Latest durably committed timestamp.
+};
+
+// Adaptive controller for the chunk and batch sizes. Grows the chunks until the target
+// throughput is reached or the memory ceiling is hit, taking the portion of the items passing
+// the filtering and the round trip of the retrievals into account. The batches are kept large enough
+// for the commit latency to stay insignificant, yet small enough for the time between commits to stay
+// within the maximum lag.
+class CIXAdaptiveSizing : public CLifeReporterAgent< CIXAdaptiveSizing >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXAdaptiveSizing > SHP;
+
+    // Default bounds of the controller.
+    static constexpr double c_dDefaultItemsPerSecond = 1000000.0;  // Target throughput.
+    static const int c_iDefaultMaxCommitLagMs = 1000;  // Maximum time between commits.
+    static const size_t c_stDefaultMemoryCeiling = 64 << 20;  // Memory available to the chunks.
+
+    // Fixed sizes, also the initial ones of the controller.
+    static const int c_iInitialChunkSize = 10;
+    static const int c_iInitialBatchSize = 18;
+
+    // Constructor.
+    CIXAdaptiveSizing( double dTargetItemsPerSecond, chrono::milliseconds msMaxCommitLag, size_t stMemoryCeiling,
+            int iInitialChunkSize, int iInitialBatchSize )
+        : m_dTargetItemsPerSecond( dTargetItemsPerSecond ),
+          m_dMaxCommitLag( chrono::duration< double >( msMaxCommitLag ).count() ),
+          m_iMaxChunkSize( static_cast< int >( std::min< size_t >( stMemoryCeiling / ( 2 * sizeof( CIXItem ) ), INT32_MAX ) ) ),
+          m_iChunkSize( iInitialChunkSize ), m_iBatchSize( iInitialBatchSize ),
+          m_dItemsPerChunk( iInitialChunkSize ), m_dYield( 1.0 ), m_dItemsPerSecond( 0.0 ), m_dCycleSeconds( 0.0 ),
+          m_dRetrievalSeconds( 0.0 ), m_dCommitSeconds( 0.0 ),
+          m_bPrevious( false ), m_iPreviousReceived( 0 )
+    {
+        // The memory ceiling is shared by the current and the prefetched chunk.
+        m_iMaxChunkSize = std::max( 1, m_iMaxChunkSize );
+    }
+
+    // Destructor.
+    virtual ~CIXAdaptiveSizing()
+    {
+    }
+
+    // Returns the current chunk size.
+    int GetChunkSize() const { return m_iChunkSize.load( memory_order_relaxed ); }
+
+    // Returns the current batch size.
+    int GetBatchSize() const { return m_iBatchSize.load( memory_order_relaxed ); }
+
+    // Records the outcome of a data retrieval.
+    void RecordRetrieval( chrono::nanoseconds nsElapsed, int iRequested, int iReceived )
+    {
+        // Measure the throughput over the whole cycle since the previous retrieval, indexing included.
+        lock_guard< mutex > lock( m_mutex );
+        chrono::steady_clock::time_point tpNow = chrono::steady_clock::now();
+        if( m_bPrevious )
+        {
+            double dCycle = chrono::duration< double >( tpNow - m_tpPrevious ).count();
+            if( dCycle > 0.0 )
+            {
+                m_dItemsPerSecond = Smooth( m_dItemsPerSecond, m_iPreviousReceived / dCycle );
+                m_dCycleSeconds = Smooth( m_dCycleSeconds, dCycle );
+
+            }  // end if
+
+        }  // end if
+        m_bPrevious = true;
+        m_tpPrevious = tpNow;
+        m_iPreviousReceived = iReceived;
+
+        // Track the round trip of the retrieval itself.
+        m_dRetrievalSeconds = Smooth( m_dRetrievalSeconds, chrono::duration< double >( nsElapsed ).count() );
+
+        // Track the portion of the timestamps yielding items.
+        if( iRequested > 0 )
+            m_dYield = Smooth( m_dYield, static_cast< double >( iReceived ) / iRequested );
+
+        // Delegate.
+        Adjust();  // void
+    }
+
+    // Records the outcome of a commit.
+    void RecordCommit( chrono::nanoseconds nsElapsed )
+    {
+        // Track the latency.
+        lock_guard< mutex > lock( m_mutex );
+        m_dCommitSeconds = Smooth( m_dCommitSeconds, chrono::duration< double >( nsElapsed ).count() );
+
+        // Delegate.
+        Adjust();  // void
+    }
+
+private:
+
+    // Exponentially weighted moving average.
+    static double Smooth( double dAverage, double dSample )
+    {
+        return dAverage == 0.0 ? dSample : 0.8 * dAverage + 0.2 * dSample;
+    }
+
+    // Publishes a new size if it differs enough from the current one. Avoiding small changes
+    // keeps the prefetched chunks valid.
+    static void Publish( atomic< int >& iSize, int iNew )
+    {
+        int iOld = iSize.load( memory_order_relaxed );
+        if( iNew > iOld + iOld / 4 || iNew < iOld - iOld / 4 )
+            iSize.store( iNew, memory_order_relaxed );  // void
+    }
+
+    // Recomputes the sizes from the measurements.
+    void Adjust()
+    {
+        // Keep the initial sizes until the throughput is known.
+        if( m_dItemsPerSecond <= 0.0 )
+            return;
+
+        // Grow the chunks below the target throughput and shrink them well above it. The round trip
+        // costs about the same for any chunk size, so the chunks dominated by it grow faster and
+        // are never shrunk, which would only multiply the round trips.
+        bool bRoundTripBound = m_dRetrievalSeconds > 0.5 * m_dCycleSeconds;
+        if( m_dItemsPerSecond < m_dTargetItemsPerSecond )
+            m_dItemsPerChunk *= bRoundTripBound ? 1.5 : 1.25;
+        else if( m_dItemsPerSecond > 2.0 * m_dTargetItemsPerSecond && bRoundTripBound == false )
+            m_dItemsPerChunk *= 0.8;
+        m_dItemsPerChunk = std::clamp( m_dItemsPerChunk, 1.0, static_cast< double >( m_iMaxChunkSize ) );
+
+        // Request enough timestamps to obtain the desired items after the filtering.
+        double dChunk = m_dItemsPerChunk / std::max( m_dYield, 0.01 );
+        int iChunkSize = static_cast< int >( std::clamp( dChunk, 1.0, static_cast< double >( m_iMaxChunkSize ) ) );
+        Publish( m_iChunkSize, iChunkSize );  // void
+
+        // Keep the commit latency below a tenth of the batch duration and commit at most once per chunk,
+        // but always within the maximum lag.
+        double dMaxBatch = std::max( 1.0, m_dItemsPerSecond * m_dMaxCommitLag );
+        double dMinBatch = std::min( m_dItemsPerChunk, dMaxBatch );
+        double dBatch = std::clamp( 10.0 * m_dCommitSeconds * m_dItemsPerSecond, dMinBatch, dMaxBatch );
+        Publish( m_iBatchSize, static_cast< int >( std::min( dBatch, static_cast< double >( INT32_MAX ) ) ) );  // void
+    }
+
+private:
+    double m_dTargetItemsPerSecond;  // Target throughput.
+    double m_dMaxCommitLag;  // Maximum time between commits in seconds.
+    int m_iMaxChunkSize;  // Maximum chunk size allowed by the memory ceiling.
+    atomic< int > m_iChunkSize;  // Current chunk size.
+    atomic< int > m_iBatchSize;  // Current batch size.
+    mutex m_mutex;  // Guards the measurements, which come from the job and the committer threads.
+    double m_dItemsPerChunk;  // Desired items per chunk after filtering.
+    double m_dYield;  // Average portion of the requested timestamps yielding items.
+    double m_dItemsPerSecond;  // Average throughput.
+    double m_dCycleSeconds;  // Average time between the retrievals.
+    double m_dRetrievalSeconds;  // Average round trip of a retrieval.
+    double m_dCommitSeconds;  // Average commit latency.
+    bool m_bPrevious;  // Indicates whether there was a previous retrieval.
+    chrono::steady_clock::time_point m_tpPrevious;  // Time of the previous retrieval.
+    int m_iPreviousReceived;  // Items received in the previous retrieval.
+};
+
+// Callback implementation.
+class CIXCallback : public IIXCallback, public CLifeReporterAgent< CIXCallback >
+{
+public:
+
+    // Constructor.
+    CIXCallback( IIXDataRetrieval::SHP shpDataRetrieval, IIXIndexing::SHP shpIndexing, const CLogicalTimestamp& ltLatestSeen,
+            bool bAsyncCommit = false, IIXTimestampManager::SHP shpTimestampManager = IIXTimestampManager::SHP(),
+            CIXAdaptiveSizing::SHP shpSizing = CIXAdaptiveSizing::SHP(), bool bColumnar = false,
+            IIXMonitor::SHP shpMonitor = IIXMonitor::SHP() )
+        : m_shpDataRetrieval( shpDataRetrieval ), m_shpIndexing( shpIndexing ),
+          m_shpTimestampManager( shpTimestampManager ), m_shpSizing( shpSizing ), m_shpMonitor( shpMonitor ),
+          m_bColumnar( bColumnar ),
+          m_ltLatestSeen( ltLatestSeen ), m_ltDurable( ltLatestSeen )
+    {
+        // Commit in the background if requested.
+        if( bAsyncCommit )
+            m_upCommitter.reset( new CIXGroupCommitter( [ this ]( const CLogicalTimestamp& lt, int iActualCount )
+                    { return CommitNow( lt, iActualCount ); } ) );
+    }
+
+    // Destructor.
+    virtual ~CIXCallback()
+    {
+        // Complete the pending commits before the members go.
+        m_upCommitter.reset();  // void
+    }
+
+// IIXCallback
+public:
+
+    // Returns the batch size.
+    virtual int GetBatchSize() override
+    {
+        // Batch size.
+        return m_shpSizing ? m_shpSizing->GetBatchSize() : CIXAdaptiveSizing::c_iInitialBatchSize;
+    }
+
+    // Returns the chunk size.
+    virtual int GetChunkSize() override
+    { 
+        // Chunk size.
+        return m_shpSizing ? m_shpSizing->GetChunkSize() : CIXAdaptiveSizing::c_iInitialChunkSize;
+    }
+
+    // Indicates whether the chunks are held column by column.
+    virtual bool IsColumnar() override
+    {
+        // Layout.
+        return m_bColumnar;
+    }
+
+    // Accesses the latest seen timestamp.
+    virtual const CLogicalTimestamp& AccessLatestSeen() const override
+    {
+        // Access the timestamp.
+        return m_ltLatestSeen;
+    }
+
+    // Updates the locally stored timestamp if the provided one is later.
+    virtual void UpdateIfLater( const CLogicalTimestamp& ltProvided ) override
+    {
+        // Delegate to the timestamp.
+        m_ltLatestSeen.UpdateIfLater( ltProvided );  // void
+    }
+
+    // Accesses the data source.
+    virtual const IIXDataRetrieval::SHP AccessDataRetrieval() override
+    {
+        // Access the data retrieval.
+        return m_shpDataRetrieval;
+    }
+
+    // Accesses the indexing engine.
+    virtual const IIXIndexing::SHP AccessIndexing() override
+    {
+        // Access the data source.
+        return m_shpIndexing;
+    }
+
+    // Commits the progress of a batch.
+    virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) override
+    {
+        // Queue or commit right away.
+        return m_upCommitter
+                ? m_upCommitter->Enqueue( lt, iActualCount )
+                : CommitNow( lt, iActualCount );
+    }
+
+    // Gets the latest durably committed timestamp.
+    virtual CLogicalTimestamp GetDurable() const override
+    {
+        // Delegate to the committer if any.
+        return m_upCommitter ? m_upCommitter->GetDurable() : m_ltDurable;
+    }
+
+    // Waits for the commits completing in the background.
+    virtual bool Flush() override
+    {
+        // Delegate to the committer if any.
+        return m_upCommitter ? m_upCommitter->Flush() : true;
+    }
+
+    // Records the outcome of a data retrieval.
+    virtual void RecordRetrieval( chrono::nanoseconds nsElapsed, int iRequested, int iReceived ) override
+    {
+        // Feed the sizing and the monitor.
+        if( m_shpSizing )
+            m_shpSizing->RecordRetrieval( nsElapsed, iRequested, iReceived );  // void
+        if( m_shpMonitor )
+            m_shpMonitor->RecordChunk( nsElapsed, iRequested, iReceived );  // void
+    }
+
+    // Records the outcome of a commit.
+    virtual void RecordCommit( chrono::nanoseconds nsElapsed, int iActualCount ) override
+    {
+        // Feed the sizing and the monitor.
+        if( m_shpSizing )
+            m_shpSizing->RecordCommit( nsElapsed );  // void
+        if( m_shpMonitor )
+            m_shpMonitor->RecordPostBatch( nsElapsed, iActualCount );  // void
+    }
+
+    // Accesses the monitor, if any.
+    virtual const IIXMonitor::SHP AccessMonitor() override
+    {
+        // Access the monitor.
+        return m_shpMonitor;
+    }
+
+private:
+
+    // Commits to the indexing engine.
+    bool CommitNow( const CLogicalTimestamp& lt, int iActualCount )
+    {
+        // Commit the index first and only then persist the timestamp, so that a restart never skips items.
+        chrono::steady_clock::time_point tpStart = chrono::steady_clock::now();
+        bool bSuccess = m_shpIndexing && m_shpIndexing->Commit( lt, iActualCount );
+        if( bSuccess && m_shpTimestampManager )
+            bSuccess = m_shpTimestampManager->Commit( lt );
+        RecordCommit( chrono::steady_clock::now() - tpStart, iActualCount );  // void
+
+        // Track the durable timestamp.
+        if( bSuccess )
+            m_ltDurable.UpdateIfLater( lt );  // void
+        return bSuccess;
+    }
+
+private:
+    IIXDataRetrieval::SHP m_shpDataRetrieval;  // Data retrieval interface.
+    IIXIndexing::SHP m_shpIndexing;  // Indexing engine interface.
+    IIXTimestampManager::SHP m_shpTimestampManager;  // Timestamp manager interface, if any.
+    CIXAdaptiveSizing::SHP m_shpSizing;  // Adaptive sizing, if any.
+    IIXMonitor::SHP m_shpMonitor;  // Monitor, if any.
+    bool m_bColumnar;  // Indicates whether the chunks are held column by column.
+    CLogicalTimestamp m_ltLatestSeen;  // Latest seen timestamp.
+    CLogicalTimestamp m_ltDurable;  // Latest durably committed timestamp, when committing synchronously.
+    unique_ptr< CIXGroupCommitter > m_upCommitter;  // Background committer, when committing asynchronously.
+};
+
+// Enumerator interface.
+class IIXEnumerable
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXEnumerable > SHP;
+
+    // Helper types.
+    typedef unique_ptr< IIXEnumerable > UP;
+
+    // Proceeds the enumerator.
+    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen ) = 0;
+    
+    // Gets the current item.
+    virtual CResult< CIXItem > Current() const = 0;
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    virtual CResult< span< const CIXItem > > CurrentChunk() const = 0;
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    virtual CResult< CIXItemColumnsView > CurrentColumns() const = 0;
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    virtual CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen ) = 0;
+
+    // Resets the enumerator.
+    virtual void Reset( IIXCallback::SHP shpCB ) = 0;
+
+    // Begins the enumeration anew, reusing the object.
+    virtual void Start( IIXCallback::SHP shpCB ) = 0;
+
+    // Destructor.
+    virtual ~IIXEnumerable()
+    {
+    }
+};
+
+// Chunk layer of the enumerator stack, composable at compile time. Retrieves one chunk of items
+// and enumerates it. TRetrieval is either the concrete data retrieval class, which is then called
+// directly, or IIXDataRetrieval for any retrieval.
+//
+// Each layer provides Start() for beginning anew and Reset() for moving on to a new lower layer
+// unit (the chunk layer has none, so both are the same).
+//
+// The chunk is held either as rows or column by column, as the callback specifies.
+template< typename TRetrieval >
+class TIXChunked
+{
+public:
+
+    // Constructor.
+    TIXChunked()
+        : m_bColumnar( false ), m_bRetrieved( false ), m_bExhausted( false ), m_stCurrent( 0 )
+    {
+    }
+
+    // Begins anew.
+    void Start( IIXCallback::SHP shpCB )
+    {
+        // Delegate.
+        Reset( shpCB );  // void
+    }
+
+    // Resets the layer for the next chunk. The buffer keeps its capacity.
+    void Reset( IIXCallback::SHP shpCB )
+    {
+        // Reset the members.
+        _ASSERTE( shpCB );
+        if( m_shpCB != shpCB )
+        {
+            m_shpCB = shpCB;
+            m_shpRetrieval = ResolveRetrieval( shpCB );
+            m_bColumnar = shpCB->IsColumnar();
+        }
+        m_bRetrieved = false;
+        m_bExhausted = false;
+        m_vecItems.clear();
+        m_columns.Clear();  // void
+        m_stCurrent = 0;
+    }
+
+    // Proceeds the enumerator.
+    CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Initialize or proceed the enumerator. 
+        CIXAvailability retval( CIXAvailability::Available::No, ltLatestSeen );
+        if( m_bRetrieved == false )
+        {
+            // Retrieve the data as we have not done that yet.
+            retval = RetrieveData( ltLatestSeen );
+        }
+        else if( m_stCurrent < GetCount() )
+        {
+            // We have already attempted to retrieve some data.
+
+            // Proceed with the iterator.
+            m_stCurrent++;
+
+            // Determine the continuation status.
+            retval = m_stCurrent < GetCount()
+                    ? CIXAvailability( CIXAvailability::Available::Yes, m_ltLatestKnown )
+                    : m_bExhausted
+                            ? CIXAvailability( CIXAvailability::Available::No, m_ltLatestKnown )
+                            : CIXAvailability( CIXAvailability::Available::Perhaps, m_ltLatestKnown );
+        }  // end if
+
+        // Inspect the availability status.
+        switch( retval.AccessAvailability() )
+        {
+        case CIXAvailability::Available::Perhaps:
+
+            // Debug output.
+            IX_LOG( Debug, Indent( 2 ) << "Perhaps more data available." );
+            break;
+
+        case CIXAvailability::Available::No:
+
+            // Debug output.
+            IX_LOG( Debug, Indent( 2 ) << "No more data available." );
+            break;
+
+        default:
+            break;
+
+        }  // end switch
+
+        // Return value.
+        return CResult< CIXAvailability >( true, retval );
+    }
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Skip directly to the last item so that the next step determines the continuation status.
+        if( m_bRetrieved && m_stCurrent < GetCount() )
+            m_stCurrent = GetCount() - 1;
+
+        // Delegate.
+        return MoveNext( ltLatestSeen );
+    }
+
+    // Gets the current item.
+    CResult< CIXItem > Current() const
+    {
+        // Do we have data available?
+        if( m_stCurrent >= GetCount() )
+        {
+            // No, raise an error.
+            return CResult< CIXItem >( false, CIXItem() );
+        }
+        else
+        {
+            // Yes, return the data.
+            return CResult< CIXItem >( true, m_bColumnar ? m_columns.Row( m_stCurrent ) : m_vecItems[ m_stCurrent ] );
+
+        }  // end if
+    }
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    CResult< span< const CIXItem > > CurrentChunk() const
+    {
+        // Do we have data available?
+        if( m_stCurrent >= m_vecItems.size() )
+        {
+            // No, raise an error.
+            return CResult< span< const CIXItem > >( false, span< const CIXItem >() );
+        }
+        else
+        {
+            // Yes, expose the rest of the local container.
+            return CResult< span< const CIXItem > >( true, span< const CIXItem >( m_vecItems ).subspan( m_stCurrent ) );
+
+        }  // end if
+    }
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    CResult< CIXItemColumnsView > CurrentColumns() const
+    {
+        // Do we have data available?
+        if( m_bColumnar == false || m_stCurrent >= m_columns.GetSize() )
+        {
+            // No, raise an error.
+            return CResult< CIXItemColumnsView >( false, CIXItemColumnsView() );
+        }
+        else
+        {
+            // Yes, expose the rest of the local columns.
+            return CResult< CIXItemColumnsView >( true, m_columns.View().Subview( m_stCurrent ) );
+
+        }  // end if
+    }
+
+private:
+
+    // Gets the number of items in the local container.
+    size_t GetCount() const
+    {
+        return m_bColumnar ? m_columns.GetSize() : m_vecItems.size();
+    }
+
+    // Resolves the data retrieval from the callback.
+    static shared_ptr< TRetrieval > ResolveRetrieval( IIXCallback::SHP shpCB )
+    {
+        // A statically chosen retrieval must be exactly the actual one. It is called bypassing the
+        // virtual dispatch, so a derived class would silently run the implementation of its base.
+        IIXDataRetrieval::SHP shpDataRetrieval = shpCB->AccessDataRetrieval();
+        if constexpr( is_same_v< TRetrieval, IIXDataRetrieval > )
+            return shpDataRetrieval;
+        else
+        {
+            if( shpDataRetrieval && typeid( *shpDataRetrieval ) != typeid( TRetrieval ) )
+                throw CIXException( __LINE__, "Unexpected data retrieval type" );
+            return static_pointer_cast< TRetrieval >( shpDataRetrieval );
+
+        }  // end if
+    }
+
+    // Attempts to retrieve data to the local container.
+    CIXAvailability RetrieveData( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Use the data source if available.
+        _ASSERTE( m_shpCB );
+        m_ltLatestKnown = ltLatestSeen;
+        CIXAvailability retval( CIXAvailability::Available::No, m_ltLatestKnown );
+        if( m_shpRetrieval )
+        {
+            // Retrieve the data and set the iterator. A concrete retrieval is called
+            // directly, bypassing the virtual dispatch.
+            int iChunkSize = m_shpCB->GetChunkSize();
+            chrono::steady_clock::time_point tpStart = chrono::steady_clock::now();
+            if( m_bColumnar )
+            {
+                if constexpr( is_same_v< TRetrieval, IIXDataRetrieval > )
+                    m_ltLatestKnown = IX_TRY( m_shpRetrieval->RetrieveColumns( ltLatestSeen, iChunkSize,
+                            OUT m_bExhausted, OUT m_columns ) );
+                else
+                    m_ltLatestKnown = IX_TRY( m_shpRetrieval->TRetrieval::RetrieveColumns( ltLatestSeen, iChunkSize,
+                            OUT m_bExhausted, OUT m_columns ) );
+            }
+            else
+            {
+                if constexpr( is_same_v< TRetrieval, IIXDataRetrieval > )
+                    m_ltLatestKnown = IX_TRY( m_shpRetrieval->RetrieveData( ltLatestSeen, iChunkSize,
+                            OUT m_bExhausted, OUT m_vecItems ) );
+                else
+                    m_ltLatestKnown = IX_TRY( m_shpRetrieval->TRetrieval::RetrieveData( ltLatestSeen, iChunkSize,
+                            OUT m_bExhausted, OUT m_vecItems ) );
+
+            }  // end if
+            m_stCurrent = 0;
+            m_shpCB->RecordRetrieval( chrono::steady_clock::now() - tpStart, iChunkSize,
+                    static_cast< int >( GetCount() ) );  // void
+
+            // The next chunk starts from the latest known timestamp of this one.
+            if( m_bExhausted == false )
+                m_shpRetrieval->Prefetch( m_ltLatestKnown, iChunkSize );  // void
+
+        }  // end if
+
+        // Initialization status.
+        m_bRetrieved = true;
+
+        // Continuation status.
+        if( m_ltLatestKnown.IsLaterThan( ltLatestSeen ) )
+        {
+            // Construct the availability result.
+            retval = CIXAvailability( 
+                    m_stCurrent < GetCount()
+                            ? CIXAvailability::Available::Yes 
+                            : m_bExhausted
+                                    ? CIXAvailability::Available::No
+                                    : CIXAvailability::Available::Perhaps,
+                    m_ltLatestKnown );
+        }
+
+        return retval;
+    }
+
+private:
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    shared_ptr< TRetrieval > m_shpRetrieval;  // Data retrieval.
+    bool m_bColumnar;  // Indicates whether the chunk is held column by column.
+    bool m_bRetrieved;  // Indicates whether the data has been retrieved.
+    CLogicalTimestamp m_ltLatestKnown;  // Latest known timestamp.
+    bool m_bExhausted;  // Indicates whether the data source was exhausted.
+    vector< CIXItem > m_vecItems;  // Local container for items.
+    CIXItemColumns m_columns;  // Local container for items held column by column.
+    size_t m_stCurrent;  // Position of the current item.
+};
+
+// Batch layer of the enumerator stack, composable at compile time. Splits the enumeration
+// into chunks provided by the lower layer and commits the progress after each batch.
+template< typename TLower >
+class TIXBatched
+{
+public:
+
+    // Constructor.
+    TIXBatched()
+        : m_iChunks( 0 ), m_iChunkCapacity( 0 ), m_iCurrentCount( 0 )
+    {
+    }
+
+    // Begins a new batch.
+    void Start( IIXCallback::SHP shpCB )
+    {
+        // Reset the counters.
+        m_shpCB = shpCB;
+        m_iChunks = 0;
+        m_iChunkCapacity = 0;
+        m_iCurrentCount = 0;
+
+        // Delegate.
+        Reset( shpCB );  // void
+    }
+
+    // Moves on to the next chunk.
+    void Reset( IIXCallback::SHP shpCB )
+    {
+        // Restart the lower enumerator layer.
+        IX_LOG( Debug, Indent( 1 ) << "Chunk being initialized." );
+        m_lower.Start( shpCB );  // void
+        m_iChunks++;
+        m_iChunkCapacity += shpCB->GetChunkSize();
+    }
+
+    // Proceeds the enumerator.
+    CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Delegate.
+        return MoveNextImpl( ltLatestSeen, false );
+    }
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Delegate.
+        return MoveNextImpl( ltLatestSeen, true );
+    }
+
+    // Gets the current item.
+    CResult< CIXItem > Current() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.Current();
+    }
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    CResult< span< const CIXItem > > CurrentChunk() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.CurrentChunk();
+    }
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    CResult< CIXItemColumnsView > CurrentColumns() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.CurrentColumns();
+    }
+
+private:
+
+    // Proceeds the enumerator either by one item or past the rest of the current chunk.
+    CResult< CIXAvailability > MoveNextImpl( const CLogicalTimestamp& ltLatestSeen_, bool bChunkwise )
+    {
+        // Locals.
+        CResult< CIXAvailability > res( true, CIXAvailability() );
+        CIXAvailability availability;
+        CLogicalTimestamp ltLatestSeen = ltLatestSeen_;
+        bool bContinueWithNewerTimestamp = true;
+
+        // Loop while lower layers do not return a definitive Yes/No answer.
+        while( bContinueWithNewerTimestamp )
+        {
+            // Reset the continuation flag.
+            bContinueWithNewerTimestamp = false;
+
+            // Proceed the enumerator.
+            if( bChunkwise )
+            {
+                // The skipped items count as received, except the current one which already did.
+                size_t stRemaining = GetChunkRemaining();
+                if( stRemaining > 0 )
+                    m_iCurrentCount += static_cast< int >( stRemaining ) - 1;
+
+                // Only the first step may skip a chunk.
+                res = m_lower.MoveNextChunk( ltLatestSeen );
+                bChunkwise = false;
+            }
+            else
+            {
+                // Proceed by one item.
+                res = m_lower.MoveNext( ltLatestSeen );
+
+            }  // end if
+
+            // Track the return value.
+            availability = IX_TRY( res );
+            switch( availability.AccessAvailability() )
+            {
+
+            // Data available.
+            case CIXAvailability::Available::Yes:
+
+                // Track the number of the received items.
+                m_iCurrentCount++;
+                break;
+
+            // No data available.
+            case CIXAvailability::Available::No:
+
+                // Data source has been exhausted, so we need to commit the status.
+                // TODO: FastForward?
+                IX_TRY( Commit( ltLatestSeen ) );  // Return value ignored.
+                break;
+
+            // Perhaps data available.
+            case CIXAvailability::Available::Perhaps:
+
+                // There might be more data available, but in order to determine that we 
+                // need to re-initialize the lower layers when we proceed the enumerator
+                // next time. Before doing that, we must commit the current status if we
+                // have received more items than the batch size.
+                if( IsIntermediateCommitNeeded() )
+                {
+                    // Commit the current status.
+                    IX_TRY( Commit( ltLatestSeen ) );  // Return value ignored.
+                }
+                else
+                {
+                    // Sanity check.
+                    //***if( availability.AccessLatestKnownTimestamp().IsLaterThan( ltLatestSeen ) == false )
+                    //***    return CResult< CIXAvailability >( false, res.AccessRetVal() );
+
+                    // Forward the timestamp.
+                    m_shpCB->UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+
+                    // Reset the lower layers.
+                    Reset( m_shpCB );  // void
+
+                    // Use the updated timestamp.
+                    ltLatestSeen = m_shpCB->AccessLatestSeen();
+
+                    // Indicate that the loop should continue.
+                    bContinueWithNewerTimestamp = true;
+
+                }  // end if
+
+                break;
+
+            default:
+                break;
+
+            }  // end switch
+
+        }  // end while
+
+        return res;
+    }
+
+    // Gets the number of the remaining items of the current chunk in either layout.
+    size_t GetChunkRemaining() const
+    {
+        // Try the rows first.
+        CResult< span< const CIXItem > > resChunk = m_lower.CurrentChunk();
+        if( resChunk.Success() )
+            return resChunk.AccessRetVal().size();
+        CResult< CIXItemColumnsView > resColumns = m_lower.CurrentColumns();
+        return resColumns.Success() ? resColumns.AccessRetVal().GetSize() : 0;
+    }
+
+    // Commits the current progress. Fails if the commit, or an earlier one completed in the
+    // background, failed, so that the crawl does not continue past a durable timestamp that stays behind.
+    CResult< bool > Commit( const CLogicalTimestamp& lt )
+    {
+        // Try to commit. The callback may complete the commit in the background.
+        _ASSERTE( m_shpCB );
+        bool bSuccess = m_shpCB->Commit( lt, m_iCurrentCount );
+        if( bSuccess == false )
+            IX_LOG( Error, "*** Commit at ts( " << lt.Get() << " ) failed, durable at ts( " << m_shpCB->GetDurable().Get() << " )." );
+
+        // Reset the counter for batch content.
+        m_iCurrentCount = 0;
+
+        // Return value.
+        return CResult< bool >( bSuccess, bSuccess );
+    }
+
+    // Is intermediate commit needed?
+    bool IsIntermediateCommitNeeded()
+    {
+        // Is the batch full?
+        bool bBatchFull =
+                m_iCurrentCount > 0 && m_iCurrentCount >= m_shpCB->GetBatchSize();
+
+        // Do the chunks equal to a batch (even though we haven't seen them all)?
+        // The chunk size may have changed between the chunks.
+        bool bChunksEqualToBatch =
+                m_iChunkCapacity >= m_shpCB->GetBatchSize();
+
+        return bBatchFull || bChunksEqualToBatch;
+    }
+
+private:
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    TLower m_lower;  // The lower layer enumerator.
+    int m_iChunks;  // The number of chunks used.
+    int m_iChunkCapacity;  // The sum of the chunk sizes used.
+    int m_iCurrentCount;  // The number of the processed items.
+};
+
+// Top layer of the enumerator stack, composable at compile time. Splits the enumeration
+// into batches provided by the lower layer.
+template< typename TLower >
+class TIXEnumerator
+{
+public:
+
+    // Begins anew.
+    void Start( IIXCallback::SHP shpCB )
+    {
+        // Delegate.
+        Reset( shpCB );  // void
+    }
+
+    // Moves on to the next batch.
+    void Reset( IIXCallback::SHP shpCB )
+    {
+        // Restart the lower enumerator layer.
+        IX_LOG( Debug, "Batch being initialized." );
+        m_shpCB = shpCB;
+        if( const IIXMonitor::SHP shpMonitor = shpCB->AccessMonitor() )
+            shpMonitor->RecordPreBatch();  // void
+        m_lower.Start( shpCB );  // void
+    }
+
+    // Proceeds the enumerator.
+    CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Delegate.
+        return MoveNextImpl( ltLatestSeen, false );
+    }
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen )
+    {
+        // Delegate.
+        return MoveNextImpl( ltLatestSeen, true );
+    }
+
+    // Gets the current item.
+    CResult< CIXItem > Current() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.Current();
+    }
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    CResult< span< const CIXItem > > CurrentChunk() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.CurrentChunk();
+    }
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    CResult< CIXItemColumnsView > CurrentColumns() const
+    {
+        // Delegate to the lower layer.
+        return m_lower.CurrentColumns();
+    }
+
+private:
+
+    // Proceeds the enumerator either by one item or past the rest of the current chunk.
+    CResult< CIXAvailability > MoveNextImpl( const CLogicalTimestamp& ltLatestSeen_, bool bChunkwise )
+    {
+        // Locals.
+        CResult< CIXAvailability > res( true, CIXAvailability() );
+        CIXAvailability availability;
+        CLogicalTimestamp ltLatestSeen = ltLatestSeen_;
+        bool bContinueWithNewerTimestamp = true;
+
+        // Loop while lower layers do not return a definitive Yes/No answer.
+        while( bContinueWithNewerTimestamp )
+        {
+            // Reset the continuation flag.
+            bContinueWithNewerTimestamp = false;
+
+            // Delegate to the lower layer enumerator. Only the first step may skip a chunk.
+            res = bChunkwise
+                    ? m_lower.MoveNextChunk( ltLatestSeen )
+                    : m_lower.MoveNext( ltLatestSeen );
+            bChunkwise = false;
+            availability = IX_TRY( res );
+
+            // Check the current availability first.
+            if( availability.AccessAvailability() == CIXAvailability::Available::Perhaps )
+            {
+                // Sanity check.
+                //***if( availability.AccessLatestKnownTimestamp().IsLaterThan( ltLatestSeen ) == false )
+                //***    return CResult< CIXAvailability >( false, res.AccessRetVal() );
+
+                // Forward the timestamp.
+                m_shpCB->UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+
+                // Reset the lower layers.
+                Reset( m_shpCB );  // void
+
+                // Use the updated timestamp.
+                ltLatestSeen = m_shpCB->AccessLatestSeen();
+
+                // Indicate that the looping should continue.
+                bContinueWithNewerTimestamp = true;
+
+            }  // end if
+
+        }  // end while
+
+        return res;
+    }
+
+private:
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    TLower m_lower;  // The lower layer enumerator.
+};
+
+// Lower layer slot holding a dynamically created enumerator object, so that the enumerator
+// classes below can be plugged into the compile-time layers. The object is created when first
+// started and recycled afterwards, so the buffers it holds are reused for each chunk.
+template< typename TEnumerable >
+class TIXDynamicLayer
+{
+public:
+
+    // Begins anew.
+    void Start( IIXCallback::SHP shpCB )
+    {
+        // Create the enumerator or restart the existing one in place.
+        if( m_upEnum == nullptr )
+            m_upEnum = IX_UP_TRY( TEnumerable::Create( shpCB ) );
+        else
+            m_upEnum->Start( shpCB );  // void
+    }
+
+    // Proceeds the enumerator.
+    CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen ) { return m_upEnum->MoveNext( ltLatestSeen ); }
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen ) { return m_upEnum->MoveNextChunk( ltLatestSeen ); }
+
+    // Gets the current item.
+    CResult< CIXItem > Current() const { return m_upEnum->Current(); }
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    CResult< span< const CIXItem > > CurrentChunk() const { return m_upEnum->CurrentChunk(); }
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    CResult< CIXItemColumnsView > CurrentColumns() const { return m_upEnum->CurrentColumns(); }
+
+private:
+    IIXEnumerable::UP m_upEnum;  // The enumerator object.
+};
+
+// Enumerator object wrapping a compile-time layer.
+template< typename TLayer >
+class TIXEnumerable : public IIXEnumerable
+{
+public:
+
+    // Destructor.
+    virtual ~TIXEnumerable()
+    {
+    }
+
+// IIXEnumerable
+public:
+
+    // Proceeds the enumerator.
+    virtual CResult< CIXAvailability > MoveNext( const CLogicalTimestamp& ltLatestSeen ) override
+    {
+        // Delegate to the layer.
+        return m_layer.MoveNext( ltLatestSeen );
+    }
+
+    // Gets the current item.
+    virtual CResult< CIXItem > Current() const override
+    {
+        // Delegate to the layer.
+        return m_layer.Current();
+    }
+
+    // Gets the remaining items of the current chunk, starting from the current item.
+    virtual CResult< span< const CIXItem > > CurrentChunk() const override
+    {
+        // Delegate to the layer.
+        return m_layer.CurrentChunk();
+    }
+
+    // Gets the remaining items of the current chunk held column by column, starting from the current item.
+    virtual CResult< CIXItemColumnsView > CurrentColumns() const override
+    {
+        // Delegate to the layer.
+        return m_layer.CurrentColumns();
+    }
+
+    // Proceeds the enumerator past the remaining items of the current chunk.
+    virtual CResult< CIXAvailability > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen ) override
+    {
+        // Delegate to the layer.
+        return m_layer.MoveNextChunk( ltLatestSeen );
+    }
+
+    // Resets the enumerator.
+    virtual void Reset( IIXCallback::SHP shpCB ) override
+    {
+        // Delegate to the layer.
+        m_layer.Reset( shpCB );  // void
+    }
+
+    // Begins the enumeration anew, reusing the object.
+    virtual void Start( IIXCallback::SHP shpCB ) override
+    {
+        // Delegate to the layer.
+        m_layer.Start( shpCB );  // void
+    }
+
+protected:
+
+    // Constructor.
+    TIXEnumerable( IIXCallback::SHP shpCB )
+    {
+        // Delegate.
+        m_layer.Start( shpCB );  // void
+    }
+
+private:
+    TLayer m_layer;  // The actual layer.
+};
+
+// Enumerator object for chunked item data.
+class CIXItemsChunked : public TIXEnumerable< TIXChunked< IIXDataRetrieval > >, public CLifeReporterAgent< CIXItemsChunked >
+{
+public:
+
+    // Factory method.
+    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    {
+        // Sanity check.
+        if( shpCB == nullptr )
+            return IIXEnumerable::UP();
+
+        // Delegate.
+        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsChunked( shpCB ) ) );
+    }
+
+    // Destructor.
+    virtual ~CIXItemsChunked()
+    {
+    }
+
+private:
+
+    // Delete the default constructor.
+    CIXItemsChunked() = delete;
+
+    // Constructor.
+    CIXItemsChunked( IIXCallback::SHP shpCB ) :
+        TIXEnumerable( shpCB )
+    {
+    }
+};
+
+// Enumerator object for batched item data.
+class CIXItemsBatched : public TIXEnumerable< TIXBatched< TIXDynamicLayer< CIXItemsChunked > > >,
+        public CLifeReporterAgent< CIXItemsBatched >
+{
+public:
+
+    // Factory method.
+    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    {
+        // Sanity check.
+        if( shpCB == nullptr )
+            return IIXEnumerable::UP();
+
+        // Delegate.
+        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsBatched( shpCB ) ) );
+    }
+
+    // Destructor.
+    virtual ~CIXItemsBatched()
+    {
+    }
+
+private:
+
+    // Delete the default constructor.
+    CIXItemsBatched() = delete;
+
+    // Constructor.
+    CIXItemsBatched( IIXCallback::SHP shpCB ) :
+        TIXEnumerable( shpCB )
+    {
+    }
+};
+
+// Top level enumerator object.
+class CIXItemsEnumerator : public TIXEnumerable< TIXEnumerator< TIXDynamicLayer< CIXItemsBatched > > >,
+        public CLifeReporterAgent< CIXItemsEnumerator >
+{
+public:
+
+    // Factory method.
+    static IIXEnumerable::UP Create( IIXCallback::SHP shpCB )
+    {
+        // Sanity check.
+        if( shpCB == nullptr )
+            return IIXEnumerable::UP();
+
+        // Delegate.
+        return IIXEnumerable::UP( static_cast< IIXEnumerable* >( new CIXItemsEnumerator( shpCB ) ) );
+    }
+
+    // Destructor.
+    virtual ~CIXItemsEnumerator()
+    {
+    }
+
+private:
+
+    // Delete the default constructor.
+    CIXItemsEnumerator() = delete;
+
+    // Constructor.
+    CIXItemsEnumerator( IIXCallback::SHP shpCB ) :
+        TIXEnumerable( shpCB )
+    {
+    }
+};
+
+// Statically composed enumerator stack over the specified concrete data retrieval.
+template< typename TRetrieval >
+using TIXComposedEnumerator = TIXEnumerator< TIXBatched< TIXChunked< TRetrieval > > >;
+
+// Input range over the items of an enumerator stack. The items are referenced in place within
+// the chunk buffer and the iterator proceeds within a chunk without calling the enumerator, which
+// is only called at the chunk boundaries. Compatible with std::ranges. TEnumerable is either
+// IIXEnumerable or a statically composed stack. The chunks must be held as rows.
+template< typename TEnumerable >
+class TIXItemRange
+{
+public:
+
+    // Marker for the end of the items.
+    class Sentinel
+    {
+    };
+
+    // Iterator over the items.
+    class Iterator
+    {
+    public:
+
+        // Iterator traits.
+        typedef input_iterator_tag iterator_concept;
+        typedef CIXItem value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const CIXItem& reference;
+
+        // Default constructor.
+        Iterator()
+            : m_pRange( nullptr ), m_pItem( nullptr ), m_pEnd( nullptr )
+        {
+        }
+
+        // Accesses the current item.
+        const CIXItem& operator*() const { return *m_pItem; }
+        const CIXItem* operator->() const { return m_pItem; }
+
+        // Proceeds to the next item.
+        Iterator& operator++()
+        {
+            // Call the enumerator only after the last item of the chunk.
+            if( ++m_pItem == m_pEnd )
+                m_pRange->NextChunk( *this );  // void
+            return *this;
+        }
+        void operator++( int ) { ++*this; }
+
+        // Checks for the end of the items.
+        friend bool operator==( const Iterator& itr, Sentinel ) { return itr.m_pItem == nullptr; }
+
+    private:
+        friend class TIXItemRange;
+        TIXItemRange* m_pRange;  // Owning range.
+        const CIXItem* m_pItem;  // Current item.
+        const CIXItem* m_pEnd;  // End of the current chunk.
+    };
+
+    // Constructor.
+    TIXItemRange( TEnumerable& enumerable, IIXCallback::SHP shpCB )
+        : m_enumerable( enumerable ), m_shpCB( shpCB )
+    {
+    }
+
+    // Starts the enumeration.
+    Iterator begin()
+    {
+        // Proceed to the first item.
+        Iterator itr;
+        itr.m_pRange = this;
+        CIXAvailability availability = IX_TRY( m_enumerable.MoveNext( m_shpCB->AccessLatestSeen() ) );
+        SetChunk( itr, availability );  // void
+        return itr;
+    }
+
+    // Marks the end.
+    Sentinel end() const { return Sentinel(); }
+
+private:
+
+    // Proceeds past the chunk whose items have all been consumed.
+    void NextChunk( Iterator& itr )
+    {
+        // Track the progress before the enumerator may commit it.
+        m_shpCB->UpdateIfLater( ( itr.m_pEnd - 1 )->AccessLT() );  // void
+
+        // Proceed to the next chunk.
+        CIXAvailability availability = IX_TRY( m_enumerable.MoveNextChunk( m_shpCB->AccessLatestSeen() ) );
+        SetChunk( itr, availability );  // void
+    }
+
+    // Points the iterator to the current chunk, or to the end.
+    void SetChunk( Iterator& itr, const CIXAvailability& availability )
+    {
+        // Any other answer than No means that there is a current item.
+        itr.m_pItem = itr.m_pEnd = nullptr;
+        if( availability.AccessAvailability() != CIXAvailability::Available::No )
+        {
+            span< const CIXItem > items = IX_TRY( m_enumerable.CurrentChunk() );
+            itr.m_pItem = items.data();
+            itr.m_pEnd = items.data() + items.size();
+
+        }  // end if
+    }
+
+private:
+    TEnumerable& m_enumerable;  // Enumerator stack.
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+};
+typedef TIXItemRange< IIXEnumerable > CIXItemRange;
+static_assert( ranges::input_range< CIXItemRange >, "CIXItemRange must be an input range." );
+
+// Indexer job interface.
+class IIXJob
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXJob > SHP;
+
+    // Helper types.
+    typedef unique_ptr< IIXJob > UP;
+
+    // Runs the job.
+    virtual void Run() = 0;
+
+    // Runs the job for one chunk. Returns false when the job is complete.
+    virtual bool Step() = 0;
+
+    // Runs the job and then follows the data source, continuing whenever new items appear, until
+    // none have appeared within the specified time.
+    virtual void Follow( chrono::milliseconds msIdle ) = 0;
+
+    // Destructor.
+    virtual ~IIXJob()
+    {
+    }
+};
+
+// Helper aspect interface
+class IAIXJob
+{
+public:
+    
+    // Resets the aspect.
+    virtual void Reset( IIXCallback::SHP shpCB ) = 0;
+
+    // Runs the job.
+    virtual void RunImpl() = 0;
+
+    // Runs the job for one chunk. Returns false when the job is complete.
+    virtual bool StepImpl() = 0;
+
+    // Continues a complete job from where it ended, reusing the enumerator.
+    virtual void RestartImpl() = 0;
+
+    // Processes the specified item.
+    virtual CResult< bool > Process( const CIXItem& item ) = 0;
+
+    // Processes the specified items as a whole.
+    virtual CResult< bool > ProcessBatch( span< const CIXItem > items ) = 0;
+
+    // Processes the specified items held column by column as a whole.
+    virtual CResult< bool > ProcessColumns( const CIXItemColumnsView& columns ) = 0;
+
+    // Destructor.
+    virtual ~IAIXJob()
+    {
+    }
+};
+
+
+// Base class for helper aspect classes for combined indexer jobs.
+class CAIXJobBase : public IAIXJob
+{
+public:
+
+    // Destructor.
+    virtual ~CAIXJobBase()
+    {
+    }
+
+    // Resets the aspect.
+    virtual void Reset( IIXCallback::SHP shpCB ) override
+    {
+        // Set the members.
+        m_shpCB = shpCB;
+        m_bStarted = false;
+
+        // Create the lower enumerator layer.
+        IX_LOG( Debug, "Enumerator being initialized." );
+        m_upLowerLayerEnum = IX_UP_TRY( CIXItemsEnumerator::Create( shpCB ) );
+    }
+
+    // Continues a complete job from where it ended, reusing the enumerator.
+    virtual void RestartImpl() override
+    {
+        // Start the enumerator anew. It continues from the latest seen timestamp.
+        m_bStarted = false;
+        m_upLowerLayerEnum->Start( m_shpCB );  // void
+    }
+
+    // Runs the job.
+    virtual void RunImpl() override
+    {
+        // Proceed chunk by chunk.
+        while( StepImpl() )
+        {
+        }
+    }
+
+protected:
+    IIXEnumerable::UP m_upLowerLayerEnum;  // The lower layer enumerator.
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    bool m_bStarted = false;  // Indicates whether the enumeration has started.
+};
+
+// Helpers for running indexer jobs.
+namespace
+{
+    // Processes the next chunk of the enumerator stack. Returns false when there are no more items.
+    template< typename TEnumerable >
+    bool IXStepChunkwise( TEnumerable& enumerable, IIXCallback::SHP shpCB, IAIXJob& job, IN OUT bool& bStarted )
+    {
+        // Proceed to the first chunk, or past the one processed by the previous step.
+        CIXAvailability availability = IX_TRY( bStarted
+                ? enumerable.MoveNextChunk( shpCB->AccessLatestSeen() )
+                : enumerable.MoveNext( shpCB->AccessLatestSeen() ) );
+        bStarted = true;
+        if( availability.AccessAvailability() == CIXAvailability::Available::No )
+            return false;
+
+        // Process the rest of the current chunk as a whole, in the layout it is held in.
+        if( shpCB->IsColumnar() )
+            IX_TRY( job.ProcessColumns( IX_TRY( enumerable.CurrentColumns() ) ) );  // Return value ignored.
+        else
+            IX_TRY( job.ProcessBatch( IX_TRY( enumerable.CurrentChunk() ) ) );  // Return value ignored.
+        return true;
+    }
+}
+
+// Helper aspect class for SearchEngine1 indexer jobs.
+class CAIXJobSearchEngine1 : public CAIXJobBase
+{
+public:
+
+    // Destructor.
+    virtual ~CAIXJobSearchEngine1()
+    {
+    }
+
+    // Runs the job for one chunk.
+    virtual bool StepImpl() override
+    {
+        // Delegate.
+        return IXStepChunkwise( *m_upLowerLayerEnum, m_shpCB, *this, IN OUT m_bStarted );
+    }
+};
+
+// Helper aspect class for indexer jobs with a statically composed enumerator stack, e.g.
+// CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXDataRetrieval > > >. The layers are
+// embedded in each other and reset in place, so the calls through the stack can be inlined
+// and no allocation takes place at the chunk and batch boundaries.
+template< typename TEnumerator >
+class CAIXJobComposed : public IAIXJob
+{
+public:
+
+    // Destructor.
+    virtual ~CAIXJobComposed()
+    {
+    }
+
+    // Resets the aspect.
+    virtual void Reset( IIXCallback::SHP shpCB ) override
+    {
+        // Set the members.
+        m_shpCB = shpCB;
+        m_bStarted = false;
+
+        // Start the enumerator.
+        IX_LOG( Debug, "Enumerator being initialized." );
+        m_enumerator.Start( shpCB );  // void
+    }
+
+    // Continues a complete job from where it ended, reusing the enumerator.
+    virtual void RestartImpl() override
+    {
+        // Start the enumerator anew. It continues from the latest seen timestamp.
+        m_bStarted = false;
+        m_enumerator.Start( m_shpCB );  // void
+    }
+
+    // Runs the job.
+    virtual void RunImpl() override
+    {
+        // Proceed chunk by chunk.
+        while( StepImpl() )
+        {
+        }
+    }
+
+    // Runs the job for one chunk.
+    virtual bool StepImpl() override
+    {
+        // Delegate.
+        return IXStepChunkwise( m_enumerator, m_shpCB, *this, IN OUT m_bStarted );
+    }
+
+protected:
+    TEnumerator m_enumerator;  // The enumerator stack.
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    bool m_bStarted = false;  // Indicates whether the enumeration has started.
+};
+
+// Data source of SearchEngine2. Instead of being enumerated, the source pushes each chunk into
+// the index job as a whole.
+class CDataSource
+{
+public:
+
+    // Pushes the next chunk. Returns false when there is no more data.
+    virtual bool next() = 0;
+
+    // Restarts from the latest committed position.
+    virtual void rewind() = 0;
+
+    // Destructor.
+    virtual ~CDataSource()
+    {
+    }
+};
+
+// Index job of SearchEngine2.
+class CIndexJob
+{
+public:
+
+    // Notifies of the progress committed.
+    virtual void onProgressUpdate( const CLogicalTimestamp& ltCommitted, int iCommittedCount ) = 0;
+
+    // Destructor.
+    virtual ~CIndexJob()
+    {
+    }
+};
+
+// Helper aspect class for SearchEngine2 indexer jobs. SearchEngine2 is push based, so there is no
+// enumerator stack: each step retrieves a chunk straight into a buffer and pushes the buffer to the
+// indexing as a whole. The batches are committed here, and a failed commit rewinds the source to
+// the latest durable timestamp, so the uncommitted items are pushed again.
+class CAIXJobSearchEngine2 : public CAIXJobBase, public CDataSource, public CIndexJob
+{
+public:
+
+    // Destructor.
+    virtual ~CAIXJobSearchEngine2()
+    {
+    }
+
+    // Resets the aspect.
+    virtual void Reset( IIXCallback::SHP shpCB ) override
+    {
+        // Set the members.
+        _ASSERTE( shpCB );
+        m_shpCB = shpCB;
+        m_shpRetrieval = shpCB->AccessDataRetrieval();
+        m_ltPosition = shpCB->AccessLatestSeen();
+        m_iUncommitted = 0;
+        m_iRewinds = 0;
+        m_bExhausted = false;
+        IX_LOG( Debug, "Data source being initialized." );
+    }
+
+    // Continues a complete job from where it ended.
+    virtual void RestartImpl() override
+    {
+        // The position is kept.
+        m_bExhausted = false;
+    }
+
+    // Runs the job for one chunk.
+    virtual bool StepImpl() override
+    {
+        // Delegate.
+        return next();
+    }
+
+// CDataSource
+public:
+
+    // Pushes the next chunk.
+    virtual bool next() override
+    {
+        // Nothing to push without the data or after the end.
+        if( m_shpRetrieval == nullptr || m_bExhausted )
+            return false;
+
+        // Retrieve the chunk in the layout it is pushed in.
+        int iChunkSize = m_shpCB->GetChunkSize();
+        bool bExhausted = false;
+        CLogicalTimestamp ltLatestKnown;
+        size_t stCount = 0;
+        if( m_iUncommitted == 0 )
+        {
+            if( const IIXMonitor::SHP shpMonitor = m_shpCB->AccessMonitor() )
+                shpMonitor->RecordPreBatch();  // void
+
+        }  // end if
+        chrono::steady_clock::time_point tpStart = chrono::steady_clock::now();
+        if( m_shpCB->IsColumnar() )
+        {
+            ltLatestKnown = IX_TRY( m_shpRetrieval->RetrieveColumns( m_ltPosition, iChunkSize, OUT bExhausted, OUT m_columns ) );
+            stCount = m_columns.GetSize();
+        }
+        else
+        {
+            ltLatestKnown = IX_TRY( m_shpRetrieval->RetrieveData( m_ltPosition, iChunkSize, OUT bExhausted, OUT m_vecItems ) );
+            stCount = m_vecItems.size();
+
+        }  // end if
+        m_shpCB->RecordRetrieval( chrono::steady_clock::now() - tpStart, iChunkSize, static_cast< int >( stCount ) );  // void
+
+        // The source ends when exhausted or when it did not proceed.
+        bool bEnd = bExhausted || ltLatestKnown.IsLaterThan( m_ltPosition ) == false;
+        if( bEnd == false )
+            m_shpRetrieval->Prefetch( ltLatestKnown, iChunkSize );  // void
+
+        // Push the chunk.
+        if( m_shpCB->IsColumnar() )
+            IX_TRY( ProcessColumns( m_columns.View() ) );  // Return value ignored.
+        else
+            IX_TRY( ProcessBatch( m_vecItems ) );  // Return value ignored.
+        m_ltPosition.UpdateIfLater( ltLatestKnown );  // void
+        m_shpCB->UpdateIfLater( m_ltPosition );  // void
+        m_iUncommitted += static_cast< int >( stCount );
+
+        // Commit a full batch, and the rest at the end.
+        if( bEnd || m_iUncommitted >= m_shpCB->GetBatchSize() )
+        {
+            // Start again from the latest durable timestamp if the commit fails, including one
+            // completing in the background at the end.
+            if( m_shpCB->Commit( m_ltPosition, m_iUncommitted ) == false || ( bEnd && m_shpCB->Flush() == false ) )
+            {
+                if( ++m_iRewinds > c_iMaxRewinds )
+                    throw CIXException( __LINE__, "Commit failed repeatedly" );
+                rewind();  // void
+                return true;
+
+            }  // end if
+            onProgressUpdate( m_ltPosition, m_iUncommitted );  // void
+            m_iUncommitted = 0;
+            m_iRewinds = 0;
+
+        }  // end if
+
+        // Continuation status.
+        m_bExhausted = bEnd;
+        return bEnd == false;
+    }
+
+    // Restarts from the latest committed position.
+    virtual void rewind() override
+    {
+        // Drop the uncommitted progress.
+        m_ltPosition = m_shpCB->GetDurable();
+        m_iUncommitted = 0;
+        m_bExhausted = false;
+        IX_LOG( Warning, "Rewound to ts( " << m_ltPosition.Get() << " )." );
+    }
+
+// CIndexJob
+public:
+
+    // Notifies of the progress committed.
+    virtual void onProgressUpdate( const CLogicalTimestamp& ltCommitted, int iCommittedCount ) override
+    {
+        // Report the progress.
+        IX_LOG( Info, "Progress updated to ts( " << ltCommitted.Get() << " ) with " << iCommittedCount << " items." );
+    }
+
+private:
+    static const int c_iMaxRewinds = 3;  // Maximum number of consecutive rewinds.
+    IIXDataRetrieval::SHP m_shpRetrieval;  // Data retrieval.
+    CLogicalTimestamp m_ltPosition;  // Timestamp the next chunk starts after.
+    int m_iUncommitted = 0;  // Number of the items pushed since the latest commit.
+    int m_iRewinds = 0;  // Number of the consecutive rewinds.
+    bool m_bExhausted = false;  // Indicates whether the source has ended.
+    vector< CIXItem > m_vecItems;  // Chunk buffer for the rows.
+    CIXItemColumns m_columns;  // Chunk buffer for the columns.
+};
+
+// Indexer job based on a templated aspect.
+template< typename TAIXJob >
+class CIXJob : public IIXJob, public TAIXJob, public CLifeReporterAgent< CIXJob< TAIXJob > >
+{
+public:
+
+    // Factory method.
+    static IIXJob::UP Create( IIXCallback::SHP shpCB )
+    {
+        // Sanity check.
+        if( shpCB == nullptr )
+            return IIXJob::UP();
+
+        // Delegate.
+        return IIXJob::UP( static_cast< IIXJob* >( new CIXJob( shpCB ) ) );
+    }
+
+    // Destructor.
+    virtual ~CIXJob()
+    {
+    }
+
+// IIXJob
+public:
+
+    // Runs the job.
+    virtual void Run() override
+    {
+        // Delegate.
+        TAIXJob::RunImpl();  // void
+    }
+
+    // Runs the job for one chunk.
+    virtual bool Step() override
+    {
+        // Delegate.
+        return TAIXJob::StepImpl();
+    }
+
+    // Runs the job and then follows the data source.
+    virtual void Follow( chrono::milliseconds msIdle ) override
+    {
+        // Block on the source between the runs instead of polling it.
+        TAIXJob::RunImpl();  // void
+        IIXDataRetrieval::SHP shpDataRetrieval = m_shpCB->AccessDataRetrieval();
+        while( shpDataRetrieval && shpDataRetrieval->WaitForData( m_shpCB->AccessLatestSeen(), msIdle ) )
+        {
+            TAIXJob::RestartImpl();  // void
+            TAIXJob::RunImpl();  // void
+
+        }  // end while
+    }
+
+// AIXJob
+public:
+
+    // Processes the specified item.
+    virtual CResult< bool > Process( const CIXItem& item ) override
+    {
+        // Try to index.
+        _ASSERTE( m_shpCB );
+        bool bSuccess = false;
+        IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
+        if( shpIndexing )
+            bSuccess = IndexTimed( *shpIndexing, 1, [ & ]( IIXIndexing& indexing ) { return indexing.Index( item ); } );
+
+        // Update the status.
+        m_shpCB->UpdateIfLater( item.AccessLT() );  // void
+
+        // Return the success status.
+        return CResult< bool >( true, bSuccess );
+    }
+
+    // Processes the specified items as a whole.
+    virtual CResult< bool > ProcessBatch( span< const CIXItem > items ) override
+    {
+        // Nothing to do for an empty batch.
+        _ASSERTE( m_shpCB );
+        if( items.empty() )
+            return CResult< bool >( true, true );
+
+        // Try to index all items with a single call.
+        bool bSuccess = false;
+        IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
+        if( shpIndexing )
+            bSuccess = IndexTimed( *shpIndexing, static_cast< int >( items.size() ), [ & ]( IIXIndexing& indexing ) { return indexing.IndexBatch( items ); } );
+
+        // Update the status. The items are in timestamp order.
+        m_shpCB->UpdateIfLater( items.back().AccessLT() );  // void
+
+        // Return the success status.
+        return CResult< bool >( true, bSuccess );
+    }
+
+    // Processes the specified items held column by column as a whole.
+    virtual CResult< bool > ProcessColumns( const CIXItemColumnsView& columns ) override
+    {
+        // Nothing to do for an empty batch.
+        _ASSERTE( m_shpCB );
+        if( columns.IsEmpty() )
+            return CResult< bool >( true, true );
+
+        // Try to index all items with a single call.
+        bool bSuccess = false;
+        IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
+        if( shpIndexing )
+            bSuccess = IndexTimed( *shpIndexing, static_cast< int >( columns.GetSize() ), [ & ]( IIXIndexing& indexing ) { return indexing.IndexColumns( columns ); } );
+
+        // Update the status. The items are in timestamp order.
+        m_shpCB->UpdateIfLater( CLogicalTimestamp( columns.AccessTimestamps()[ columns.GetSize() - 1 ] ) );  // void
+
+        // Return the success status.
+        return CResult< bool >( true, bSuccess );
+    }
+
+private:
+
+    // Delete the default constructor.
+    CIXJob() = delete;
+
+    // Constructor.
+    CIXJob( IIXCallback::SHP shpCB ) :
+        m_shpCB( shpCB ), m_shpMonitor( shpCB->AccessMonitor() )
+    {
+        // Delegate.
+        Reset( m_shpCB );  // void
+    }
+
+    // Resets the enumerator.
+    void Reset( IIXCallback::SHP shpCB )
+    {
+        // Delegate to the aspect.
+        TAIXJob::Reset( shpCB );
+    }
+
+    // Calls the indexing engine, timing a sample of the calls for the monitor.
+    template< typename TCall >
+    bool IndexTimed( IIXIndexing& indexing, int iItems, TCall call )
+    {
+        // Untimed unless sampled.
+        if( m_shpMonitor == nullptr || m_shpMonitor->IsIndexingSampled() == false )
+            return call( indexing );
+        chrono::steady_clock::time_point tpStart = chrono::steady_clock::now();
+        bool bSuccess = call( indexing );
+        m_shpMonitor->RecordIndexing( chrono::steady_clock::now() - tpStart, iItems );  // void
+        return bSuccess;
+    }
+
+private:
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    IIXMonitor::SHP m_shpMonitor;  // Monitor, if any.
+};
+
+// Thread pool with a task queue per worker. The workers run their own tasks in submission order
+// and, when idle, steal from the other end of the other queues, so the tasks spread over the
+// workers even when they are submitted from one of them.
+class CIXThreadPool : public CLifeReporterAgent< CIXThreadPool >
+{
+public:
+
+    // Helper types.
+    typedef function< void() > Task;
+
+    // Constructor.
+    CIXThreadPool( int iThreads )
+        : m_stQueues( static_cast< size_t >( std::max( 1, iThreads ) ) ), m_stNextQueue( 0 ),
+          m_stPending( 0 ), m_bStop( false )
+    {
+        // Start the workers.
+        m_upQueues.reset( new Queue[ m_stQueues ] );
+        for( size_t stWorker = 0; stWorker < m_stQueues; stWorker++ )
+            m_vecThreads.push_back( thread( &CIXThreadPool::Worker, this, stWorker ) );
+    }
+
+    // Destructor.
+    virtual ~CIXThreadPool()
+    {
+        // Stop the workers. The tasks not yet started are dropped.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+        for( thread& t : m_vecThreads )
+            t.join();
+    }
+
+    // Submits a task. A task submitted by a worker goes to the worker's own queue.
+    void Submit( Task task )
+    {
+        // Pick the queue.
+        size_t stQueue = s_pCurrentPool == this
+                ? s_stCurrentWorker
+                : m_stNextQueue.fetch_add( 1 ) % m_stQueues;
+        {
+            lock_guard< mutex > lock( m_upQueues[ stQueue ].m_mutex );
+            m_upQueues[ stQueue ].m_deqTasks.push_back( std::move( task ) );
+        }
+
+        // Wake up a worker.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_stPending++;
+        }
+        m_cv.notify_one();
+    }
+
+private:
+
+    // Task queue of a worker.
+    struct Queue
+    {
+        mutex m_mutex;  // Guards the tasks.
+        deque< Task > m_deqTasks;  // Tasks.
+    };
+
+    // Takes a task from the front of the own queue or from the back of another one.
+    bool TryTake( size_t stQueue, bool bSteal, OUT Task& task )
+    {
+        // Take.
+        Queue& queue = m_upQueues[ stQueue ];
+        lock_guard< mutex > lock( queue.m_mutex );
+        if( queue.m_deqTasks.empty() )
+            return false;
+        if( bSteal )
+        {
+            task = std::move( queue.m_deqTasks.back() );
+            queue.m_deqTasks.pop_back();
+        }
+        else
+        {
+            task = std::move( queue.m_deqTasks.front() );
+            queue.m_deqTasks.pop_front();
+
+        }  // end if
+        return true;
+    }
+
+    // Worker thread.
+    void Worker( size_t stWorker )
+    {
+        // Run the tasks until stopped.
+        s_pCurrentPool = this;
+        s_stCurrentWorker = stWorker;
+        while( true )
+        {
+            // Find a task, first from the own queue.
+            Task task;
+            bool bFound = TryTake( stWorker, false, OUT task );
+            for( size_t st = 1; bFound == false && st < m_stQueues; st++ )
+                bFound = TryTake( ( stWorker + st ) % m_stQueues, true, OUT task );
+
+            // Run it.
+            if( bFound )
+            {
+                {
+                    lock_guard< mutex > lock( m_mutex );
+                    m_stPending--;
+                }
+                task();  // void
+                continue;
+
+            }  // end if
+
+            // Wait for more.
+            unique_lock< mutex > lock( m_mutex );
+            m_cv.wait( lock, [ this ] { return m_bStop || m_stPending > 0; } );
+            if( m_bStop )
+                break;
+
+        }  // end while
+    }
+
+private:
+    static thread_local CIXThreadPool* s_pCurrentPool;  // Pool of the current worker thread, if any.
+    static thread_local size_t s_stCurrentWorker;  // Index of the current worker thread.
+    size_t m_stQueues;  // Number of queues, one per worker.
+    unique_ptr< Queue[] > m_upQueues;  // Task queues.
+    atomic< size_t > m_stNextQueue;  // Queue of the next task submitted from outside.
+    vector< thread > m_vecThreads;  // Workers.
+    mutex m_mutex;  // Guards the pending count and the stop flag.
+    condition_variable m_cv;  // Signals the pending tasks.
+    size_t m_stPending;  // Number of tasks queued.
+    bool m_bStop;  // Indicates whether the workers should stop.
+};
+
+// Initialization of static members.
+thread_local CIXThreadPool* CIXThreadPool::s_pCurrentPool = nullptr;
+thread_local size_t CIXThreadPool::s_stCurrentWorker = 0;
+
+// Indexer service running the jobs of many indexing requests on a shared thread pool. Each job
+// runs one chunk per task and then goes back to the queue, so a slow data source holds up only
+// its own job. A job never runs on two workers at once.
+class CIXIndexer : public CLifeReporterAgent< CIXIndexer >
+{
+public:
+
+    // Constructor.
+    CIXIndexer( int iThreads )
+        : m_iActive( 0 ), m_pool( iThreads )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXIndexer()
+    {
+        // Let the jobs complete.
+        Wait();  // void
+    }
+
+    // Submits the job of an indexing request.
+    void Submit( IIXJob::SHP shpJob )
+    {
+        // Track and schedule the first step.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_iActive++;
+        }
+        Schedule( shpJob );  // void
+    }
+
+    // Waits until all jobs submitted so far are complete.
+    void Wait()
+    {
+        unique_lock< mutex > lock( m_mutex );
+        m_cv.wait( lock, [ this ] { return m_iActive == 0; } );
+    }
+
+private:
+
+    // Schedules the next step of the job.
+    void Schedule( IIXJob::SHP shpJob )
+    {
+        m_pool.Submit( [ this, shpJob ] { Step( shpJob ); } );  // void
+    }
+
+    // Runs a step of the job and schedules the next one.
+    void Step( IIXJob::SHP shpJob )
+    {
+        // A failure completes the job.
+        bool bMore = false;
+        try
+        {
+            bMore = shpJob->Step();
+        }
+        catch( const CIXException& ixex )
+        {
+            IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
+        }
+        catch( const exception& ex )
+        {
+            IX_LOG( Error, "*** Exception " << ex.what() );
+        }
+
+        // Continue or complete.
+        if( bMore )
+        {
+            Schedule( shpJob );  // void
+            return;
+
+        }  // end if
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_iActive--;
+        }
+        m_cv.notify_all();
+    }
+
+private:
+    mutex m_mutex;  // Guards the active count.
+    condition_variable m_cv;  // Signals the job completions.
+    int m_iActive;  // Number of jobs not complete.
+    CIXThreadPool m_pool;  // Thread pool. Stopped first on destruction.
+};
+
+// Coordinator of a crawl split into shards by timestamp range. The shards are crawled in parallel,
+// each by its own job, and commit their progress here. As a shard may run ahead of the ones before
+// it, the progress of the whole crawl is the low watermark, i.e. the timestamp up to which all the
+// shards have committed contiguously. Only the low watermark is persisted, so a restart never skips
+// items, though it may index again the items beyond it.
+// The retrieval runs in parallel, whereas the indexing calls of the shards are serialized here.
+class CIXShardCoordinator : public CLifeReporterAgent< CIXShardCoordinator >
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< CIXShardCoordinator > SHP;
+
+    // Constructor. Splits the range after the starting timestamp up to the ending one evenly.
+    CIXShardCoordinator( IIXIndexing::SHP shpIndexing, IIXTimestampManager::SHP shpTimestampManager,
+            const CLogicalTimestamp& ltFrom, const CLogicalTimestamp& ltTo, int iShards )
+        : m_shpIndexing( shpIndexing ), m_shpTimestampManager( shpTimestampManager ), m_ltLowWatermark( ltFrom )
+    {
+        // Each shard starts from the end of the previous one.
+        _ASSERTE( m_shpIndexing );
+        int iRange = std::max( 0, ltTo.Get() - ltFrom.Get() );
+        iShards = std::max( 1, std::min( iShards, iRange ) );
+        for( int iShard = 0; iShard < iShards; iShard++ )
+        {
+            CLogicalTimestamp ltStart = m_vecShards.empty() ? ltFrom : m_vecShards.back().m_ltEnd;
+            CLogicalTimestamp ltEnd( ltFrom.Get() + static_cast< int >( static_cast< int64_t >( iRange ) * ( iShard + 1 ) / iShards ) );
+            m_vecShards.push_back( Shard{ ltStart, ltEnd, ltStart } );
+
+        }  // end for
+    }
+
+    // Destructor.
+    virtual ~CIXShardCoordinator()
+    {
+    }
+
+    // Returns the number of shards.
+    int GetShardCount() const { return static_cast< int >( m_vecShards.size() ); }
+
+    // Accesses the timestamp the shard starts from.
+    const CLogicalTimestamp& AccessShardStart( int iShard ) const { return m_vecShards[ iShard ].m_ltStart; }
+
+    // Accesses the timestamp the shard ends at, inclusive.
+    const CLogicalTimestamp& AccessShardEnd( int iShard ) const { return m_vecShards[ iShard ].m_ltEnd; }
+
+    // Gets the low watermark committed so far.
+    CLogicalTimestamp GetLowWatermark() const
+    {
+        lock_guard< mutex > lock( m_mutex );
+        return m_ltLowWatermark;
+    }
+
+    // Runs an indexing call of a shard.
+    template< typename TCall >
+    bool Index( TCall call )
+    {
+        // One shard at a time.
+        lock_guard< mutex > lock( m_mutexIndexing );
+        return call( *m_shpIndexing );
+    }
+
+    // Commits the progress of a shard.
+    bool Commit( int iShard, const CLogicalTimestamp& lt, int iActualCount )
+    {
+        // Advance the shard and find the low watermark. The shards before the first incomplete one are complete.
+        lock_guard< mutex > lock( m_mutex );
+        m_vecShards[ iShard ].m_ltWatermark.UpdateIfLater( lt );  // void
+        CLogicalTimestamp ltLow;
+        for( const Shard& shard : m_vecShards )
+        {
+            ltLow = shard.m_ltWatermark;
+            if( shard.m_ltEnd.IsLaterThan( shard.m_ltWatermark ) )
+                break;
+
+        }  // end for
+
+        // Commit the index first and only then persist the low watermark, if advanced.
+        bool bSuccess = Index( [ & ]( IIXIndexing& indexing ) { return indexing.Commit( ltLow, iActualCount ); } );
+        if( bSuccess && m_shpTimestampManager && ltLow.IsLaterThan( m_ltLowWatermark ) )
+            bSuccess = m_shpTimestampManager->Commit( ltLow );
+        if( bSuccess )
+            m_ltLowWatermark.UpdateIfLater( ltLow );  // void
+        return bSuccess;
+    }
+
+private:
+
+    // Timestamp range of a shard and its progress.
+    struct Shard
+    {
+        CLogicalTimestamp m_ltStart;  // Timestamp the shard starts from.
+        CLogicalTimestamp m_ltEnd;  // Timestamp the shard ends at, inclusive.
+        CLogicalTimestamp m_ltWatermark;  // Latest timestamp committed by the shard.
+    };
+
+private:
+    IIXIndexing::SHP m_shpIndexing;  // Indexing engine shared by the shards.
+    IIXTimestampManager::SHP m_shpTimestampManager;  // Timestamp manager, if any.
+    vector< Shard > m_vecShards;  // Shards in timestamp order.
+    mutable mutex m_mutex;  // Guards the progress.
+    mutex m_mutexIndexing;  // Serializes the calls to the indexing engine.
+    CLogicalTimestamp m_ltLowWatermark;  // Low watermark committed so far.
+};
+
+// Indexing decorator of a shard, passing the calls to the coordinator.
+class CIXShardIndexing : public IIXIndexing, public CLifeReporterAgent< CIXShardIndexing >
+{
+public:
+
+    // Constructor.
+    CIXShardIndexing( CIXShardCoordinator::SHP shpCoordinator, int iShard )
+        : m_shpCoordinator( shpCoordinator ), m_iShard( iShard )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXShardIndexing()
+    {
+    }
+
+// IIXIndexing
+public:
+
+    // Indexes data.
+    virtual bool Index( const CIXItem& item ) override
+    {
+        // Delegate.
+        return m_shpCoordinator->Index( [ & ]( IIXIndexing& indexing ) { return indexing.Index( item ); } );
+    }
+
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > items ) override
+    {
+        // Delegate.
+        return m_shpCoordinator->Index( [ & ]( IIXIndexing& indexing ) { return indexing.IndexBatch( items ); } );
+    }
+
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& columns ) override
+    {
+        // Delegate.
+        return m_shpCoordinator->Index( [ & ]( IIXIndexing& indexing ) { return indexing.IndexColumns( columns ); } );
+    }
+
+    // Indexes a batch of prepared data.
+    virtual bool IndexPrepared( span< const CIXPreparedData > data ) override
+    {
+        // Delegate.
+        return m_shpCoordinator->Index( [ & ]( IIXIndexing& indexing ) { return indexing.IndexPrepared( data ); } );
+    }
+
+    // Commits the progress of the shard.
+    virtual bool Commit( const CLogicalTimestamp& lt, int iActualCount ) override
+    {
+        // Delegate.
+        return m_shpCoordinator->Commit( m_iShard, lt, iActualCount );
+    }
+
+private:
+    CIXShardCoordinator::SHP m_shpCoordinator;  // Coordinator of the crawl.
+    int m_iShard;  // Shard number.
+};
+
+// Coroutine producing a value for the coroutine awaiting it. The task starts when awaited, and the
+// awaiting coroutine is resumed right when the task completes.
+template< typename T >
+class TIXTask
+{
+public:
+
+    // Promise of the coroutine.
+    struct promise_type
+    {
+        T m_value;  // Value produced.
+        exception_ptr m_exception;  // Exception thrown, if any.
+        coroutine_handle<> m_hContinuation;  // Coroutine awaiting the task.
+
+        // Creates the task.
+        TIXTask get_return_object() { return TIXTask( coroutine_handle< promise_type >::from_promise( *this ) ); }
+
+        // Starts when awaited.
+        suspend_always initial_suspend() noexcept { return {}; }
+
+        // Resumes the awaiting coroutine on completion.
+        auto final_suspend() noexcept
+        {
+            struct Awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                coroutine_handle<> await_suspend( coroutine_handle< promise_type > h ) noexcept
+                {
+                    coroutine_handle<> hContinuation = h.promise().m_hContinuation;
+                    return hContinuation ? hContinuation : noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Awaiter();
+        }
+
+        // Stores the value produced.
+        void return_value( T value ) { m_value = std::move( value ); }
+
+        // Stores the exception thrown, to be rethrown in the awaiting coroutine.
+        void unhandled_exception() { m_exception = current_exception(); }
+    };
+
+    // Move constructor.
+    TIXTask( TIXTask&& other ) noexcept
+        : m_h( exchange( other.m_h, nullptr ) )
+    {
+    }
+
+    // Destructor.
+    ~TIXTask()
+    {
+        if( m_h )
+            m_h.destroy();
+    }
+
+    // Awaits the task.
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend( coroutine_handle<> hAwaiting ) noexcept
+    {
+        // Start the task, which resumes the awaiting one when complete.
+        m_h.promise().m_hContinuation = hAwaiting;
+        return m_h;
+    }
+    T await_resume()
+    {
+        if( m_h.promise().m_exception )
+            rethrow_exception( m_h.promise().m_exception );
+        return std::move( m_h.promise().m_value );
+    }
+
+private:
+
+    // Constructor.
+    explicit TIXTask( coroutine_handle< promise_type > h )
+        : m_h( h )
+    {
+    }
+
+    // Delete the copying.
+    TIXTask( const TIXTask& ) = delete;
+    TIXTask& operator=( const TIXTask& ) = delete;
+
+private:
+    coroutine_handle< promise_type > m_h;  // Coroutine of the task.
+};
+
+// Coroutine running on its own and destroying itself when complete.
+struct CIXDetachedTask
+{
+    // Promise of the coroutine.
+    struct promise_type
+    {
+        CIXDetachedTask get_return_object() { return CIXDetachedTask(); }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+// Single-threaded event loop running the callbacks posted to it, either right away or after a
+// delay. The callbacks may be posted from any thread, but they all run on the thread running the
+// loop, so the coroutines resumed by them need no locking among themselves. The loop runs until
+// the tasks spawned on it are complete.
+class CIXEventLoop : public CLifeReporterAgent< CIXEventLoop >
+{
+public:
+
+    // Helper types.
+    typedef function< void() > Callback;
+
+    // Constructor.
+    CIXEventLoop()
+        : m_iActive( 0 ), m_llSequence( 0 )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXEventLoop()
+    {
+    }
+
+    // Posts a callback to run as soon as possible.
+    void Post( Callback callback )
+    {
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_deqReady.push_back( std::move( callback ) );
+        }
+        m_cv.notify_one();
+    }
+
+    // Posts a callback to run after the delay.
+    void PostAfter( chrono::steady_clock::duration delay, Callback callback )
+    {
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_pqTimers.push( Timer{ chrono::steady_clock::now() + delay, m_llSequence++, std::move( callback ) } );
+        }
+        m_cv.notify_one();
+    }
+
+    // Returns an awaitable which resumes the awaiting coroutine on the loop.
+    auto Schedule()
+    {
+        struct Awaiter
+        {
+            CIXEventLoop& m_loop;  // Event loop.
+            bool await_ready() const noexcept { return false; }
+            void await_suspend( coroutine_handle<> h ) { m_loop.Post( [ h ] { h.resume(); } ); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+    // Runs the task on the loop. The loop keeps running until the task is complete.
+    template< typename T >
+    void Spawn( TIXTask< T > task )
+    {
+        // Track and start.
+        {
+            lock_guard< mutex > lock( m_mutex );
+            m_iActive++;
+        }
+        RunDetached( std::move( task ) );  // Return value ignored.
+    }
+
+    // Runs the callbacks until the spawned tasks are complete.
+    void Run()
+    {
+        unique_lock< mutex > lock( m_mutex );
+        while( true )
+        {
+            // The timers due are ready to run.
+            chrono::steady_clock::time_point tpNow = chrono::steady_clock::now();
+            while( m_pqTimers.empty() == false && m_pqTimers.top().m_tpDue <= tpNow )
+            {
+                m_deqReady.push_back( m_pqTimers.top().m_callback );
+                m_pqTimers.pop();
+
+            }  // end while
+
+            // Run the next callback without holding the lock.
+            if( m_deqReady.empty() == false )
+            {
+                Callback callback = std::move( m_deqReady.front() );
+                m_deqReady.pop_front();
+                lock.unlock();
+                callback();  // void
+                lock.lock();
+                continue;
+
+            }  // end if
+
+            // Wait for a post or the next timer, unless all is done.
+            if( m_iActive == 0 )
+                break;
+            if( m_pqTimers.empty() )
+                m_cv.wait( lock );
+            else
+                m_cv.wait_until( lock, m_pqTimers.top().m_tpDue );
+
+        }  // end while
+    }
+
+private:
+
+    // Callback to run at a specific time.
+    struct Timer
+    {
+        chrono::steady_clock::time_point m_tpDue;  // Time to run at.
+        long long m_llSequence;  // Order of posting, for running the simultaneous ones in order.
+        Callback m_callback;  // Callback.
+
+        // Ordering for the queue.
+        bool operator>( const Timer& other ) const
+        {
+            return m_tpDue != other.m_tpDue ? m_tpDue > other.m_tpDue : m_llSequence > other.m_llSequence;
+        }
+    };
+
+    // Runs the task on the loop and tracks its completion.
+    template< typename T >
+    CIXDetachedTask RunDetached( TIXTask< T > task )
+    {
+        // Move over to the loop and run.
+        co_await Schedule();
+        co_await task;  // Return value ignored.
+
+        // Completed.
+        lock_guard< mutex > lock( m_mutex );
+        m_iActive--;
+    }
+
+private:
+    mutex m_mutex;  // Guards the members.
+    condition_variable m_cv;  // Signals the posts.
+    deque< Callback > m_deqReady;  // Callbacks ready to run.
+    priority_queue< Timer, vector< Timer >, greater< Timer > > m_pqTimers;  // Callbacks waiting for their time.
+    int m_iActive;  // Number of the spawned tasks not complete.
+    long long m_llSequence;  // Sequence number of the next timer.
+};
+
+// Asynchronous data retrieval interface. A retrieval is started and completes later on the event
+// loop, so that waiting for the data does not hold a thread.
+class IIXAsyncDataRetrieval
+{
+public:
+
+    // Helper types.
+    typedef shared_ptr< IIXAsyncDataRetrieval > SHP;
+    typedef function< void( const CResult< CLogicalTimestamp >& res, bool bExhausted ) > Completion;
+
+    // Starts retrieving data. The completion is called on the event loop, never before returning,
+    // and the items are available when it is called.
+    virtual void BeginRetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT vector< CIXItem >& vecItems,
+        Completion completion
+    ) = 0;
+
+    // Awaitable retrieval.
+    class Awaiter
+    {
+    public:
+
+        // Constructor.
+        Awaiter( IIXAsyncDataRetrieval& retrieval, const CLogicalTimestamp& ltLatestSeen, int iCount,
+                OUT bool& bExhausted, OUT vector< CIXItem >& vecItems )
+            : m_retrieval( retrieval ), m_ltLatestSeen( ltLatestSeen ), m_iCount( iCount ),
+              m_bExhausted( bExhausted ), m_vecItems( vecItems )
+        {
+        }
+
+        // Starts the retrieval and resumes the awaiting coroutine on its completion.
+        bool await_ready() const noexcept { return false; }
+        void await_suspend( coroutine_handle<> h )
+        {
+            m_retrieval.BeginRetrieveData( m_ltLatestSeen, m_iCount, OUT m_vecItems,
+                    [ this, h ]( const CResult< CLogicalTimestamp >& res, bool bExhausted )
+                    {
+                        m_res = res;
+                        m_bExhausted = bExhausted;
+                        h.resume();  // void
+                    } );  // void
+        }
+        CResult< CLogicalTimestamp > await_resume() const { return m_res; }
+
+    private:
+        IIXAsyncDataRetrieval& m_retrieval;  // Data retrieval.
+        CLogicalTimestamp m_ltLatestSeen;  // Starting point.
+        int m_iCount;  // Number of items requested.
+        bool& m_bExhausted;  // Exhaustion status of the caller.
+        vector< CIXItem >& m_vecItems;  // Items of the caller.
+        CResult< CLogicalTimestamp > m_res;  // Result.
+    };
+
+    // Retrieves data, suspending the awaiting coroutine meanwhile.
+    Awaiter RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    )
+    {
+        return Awaiter( *this, ltLatestSeen, iCount, OUT bExhausted, OUT vecItems );
+    }
+
+    // Destructor.
+    virtual ~IIXAsyncDataRetrieval()
+    {
+    }
+};
+
+// Asynchronous data retrieval for testing, completing each retrieval after a latency on the event
+// loop. The data comes from a synchronous retrieval, which must not block.
+class CIXDelayedDataRetrieval : public IIXAsyncDataRetrieval, public CLifeReporterAgent< CIXDelayedDataRetrieval >
+{
+public:
+
+    // Constructor.
+    CIXDelayedDataRetrieval( CIXEventLoop& loop, IIXDataRetrieval::SHP shpInner, chrono::microseconds usLatency )
+        : m_loop( loop ), m_shpInner( shpInner ), m_usLatency( usLatency )
+    {
+        _ASSERTE( m_shpInner );
+    }
+
+    // Destructor.
+    virtual ~CIXDelayedDataRetrieval()
+    {
+    }
+
+// IIXAsyncDataRetrieval
+public:
+
+    // Starts retrieving data.
+    virtual void BeginRetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT vector< CIXItem >& vecItems,
+        Completion completion
+    ) override
+    {
+        // Retrieve when the latency has passed.
+        IIXDataRetrieval::SHP shpInner = m_shpInner;
+        m_loop.PostAfter( m_usLatency, [ shpInner, ltLatestSeen, iCount, &vecItems, completion ]
+                {
+                    bool bExhausted = false;
+                    CResult< CLogicalTimestamp > res = shpInner->RetrieveData( ltLatestSeen, iCount, OUT bExhausted, OUT vecItems );
+                    completion( res, bExhausted );  // void
+                } );  // void
+    }
+
+private:
+    CIXEventLoop& m_loop;  // Event loop to complete on.
+    IIXDataRetrieval::SHP m_shpInner;  // Actual data retrieval.
+    chrono::microseconds m_usLatency;  // Latency of each retrieval.
+};
+
+// Asynchronous enumerator interface. The enumeration proceeds chunk by chunk, and the coroutine
+// awaiting MoveNextChunk() is suspended while the chunk is being retrieved.
+class IIXAsyncEnumerable
+{
+public:
+
+    // Proceeds to the next chunk.
+    virtual TIXTask< CResult< CIXAvailability > > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen ) = 0;
+
+    // Accesses the current chunk.
+    virtual CResult< span< const CIXItem > > CurrentChunk() const = 0;
+
+    // Destructor.
+    virtual ~IIXAsyncEnumerable()
+    {
+    }
+};
+
+// Asynchronous enumerator over the chunks of an asynchronous data retrieval. The availability
+// follows the chunk layer: Yes with items, Perhaps when the timestamp proceeded without any, and
+// No when the data is exhausted or the timestamp did not proceed.
+class CIXAsyncItemsEnumerator : public IIXAsyncEnumerable, public CLifeReporterAgent< CIXAsyncItemsEnumerator >
+{
+public:
+
+    // Constructor.
+    CIXAsyncItemsEnumerator( IIXCallback::SHP shpCB, IIXAsyncDataRetrieval::SHP shpRetrieval )
+        : m_shpCB( shpCB ), m_shpRetrieval( shpRetrieval ), m_bExhausted( false )
+    {
+        _ASSERTE( m_shpCB && m_shpRetrieval );
+    }
+
+    // Destructor.
+    virtual ~CIXAsyncItemsEnumerator()
+    {
+    }
+
+// IIXAsyncEnumerable
+public:
+
+    // Proceeds to the next chunk.
+    virtual TIXTask< CResult< CIXAvailability > > MoveNextChunk( const CLogicalTimestamp& ltLatestSeen ) override
+    {
+        // Nothing more after the exhaustion.
+        m_vecItems.clear();
+        if( m_bExhausted )
+            co_return CResult< CIXAvailability >( true, CIXAvailability( CIXAvailability::Available::No, ltLatestSeen ) );
+
+        // Retrieve the chunk.
+        CLogicalTimestamp ltLatestKnown = IX_TRY( co_await m_shpRetrieval->RetrieveData( ltLatestSeen, m_shpCB->GetChunkSize(),
+                OUT m_bExhausted, OUT m_vecItems ) );
+
+        // Continuation status.
+        CIXAvailability::Available available = CIXAvailability::Available::No;
+        if( ltLatestKnown.IsLaterThan( ltLatestSeen ) )
+            available = m_vecItems.empty() == false
+                    ? CIXAvailability::Available::Yes
+                    : m_bExhausted
+                            ? CIXAvailability::Available::No
+                            : CIXAvailability::Available::Perhaps;
+        co_return CResult< CIXAvailability >( true, CIXAvailability( available, ltLatestKnown ) );
+    }
+
+    // Accesses the current chunk.
+    virtual CResult< span< const CIXItem > > CurrentChunk() const override
+    {
+        return CResult< span< const CIXItem > >( m_vecItems.empty() == false, span< const CIXItem >( m_vecItems ) );
+    }
+
+public:
+
+    // Continues the enumeration after a rewind, even if the data source was exhausted.
+    void Rewind()
+    {
+        m_vecItems.clear();
+        m_bExhausted = false;
+    }
+
+private:
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    IIXAsyncDataRetrieval::SHP m_shpRetrieval;  // Data retrieval.
+    bool m_bExhausted;  // Indicates whether the data source was exhausted.
+    vector< CIXItem > m_vecItems;  // Current chunk.
+};
+
+// Indexer job crawling with the asynchronous enumerator. The crawl is a coroutine on an event loop
+// and suspends while a chunk is being retrieved, so one thread can drive many crawls. The batches
+// are committed as in the batch layer, and a failed batch rewinds the crawl to the latest durable
+// timestamp as in SearchEngine2.
+class CIXAsyncJob : public CLifeReporterAgent< CIXAsyncJob >
+{
+public:
+
+    // Constructor.
+    CIXAsyncJob( IIXCallback::SHP shpCB, IIXAsyncDataRetrieval::SHP shpRetrieval )
+        : m_shpCB( shpCB ), m_enumerator( shpCB, shpRetrieval )
+    {
+    }
+
+    // Destructor.
+    virtual ~CIXAsyncJob()
+    {
+    }
+
+    // Runs the job. Returns false on failure.
+    TIXTask< bool > Run()
+    {
+        // Error handling.
+        try
+        {
+            // Proceed chunk by chunk.
+            CLogicalTimestamp ltPosition = m_shpCB->AccessLatestSeen();
+            int iUncommitted = 0;
+            int iRewinds = 0;
+            bool bMore = true;
+            while( bMore )
+            {
+                // Retrieve, starting a batch if none is open.
+                if( iUncommitted == 0 )
+                {
+                    if( const IIXMonitor::SHP shpMonitor = m_shpCB->AccessMonitor() )
+                        shpMonitor->RecordPreBatch();  // void
+
+                }  // end if
+                CIXAvailability availability = IX_TRY( co_await m_enumerator.MoveNextChunk( ltPosition ) );
+                bMore = availability.AccessAvailability() != CIXAvailability::Available::No;
+
+                // Index the chunk as a whole.
+                bool bIndexed = true;
+                if( availability.AccessAvailability() == CIXAvailability::Available::Yes )
+                {
+                    span< const CIXItem > items = IX_TRY( m_enumerator.CurrentChunk() );
+                    IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
+                    if( shpIndexing )
+                        bIndexed = shpIndexing->IndexBatch( items );
+                    iUncommitted += static_cast< int >( items.size() );
+
+                }  // end if
+                ltPosition.UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+                m_shpCB->UpdateIfLater( ltPosition );  // void
+
+                // Commit a full batch, and the status at the end.
+                if( bIndexed == false || bMore == false || iUncommitted >= m_shpCB->GetBatchSize() )
+                {
+                    // Start again from the latest durable timestamp if the batch fails, including a
+                    // commit completing in the background at the end.
+                    if( bIndexed == false || m_shpCB->Commit( ltPosition, iUncommitted ) == false ||
+                            ( bMore == false && m_shpCB->Flush() == false ) )
+                    {
+                        if( ++iRewinds > c_iMaxRewinds )
+                            throw CIXException( __LINE__, "Batch failed repeatedly" );
+                        ltPosition = m_shpCB->GetDurable();
+                        iUncommitted = 0;
+                        m_enumerator.Rewind();  // void
+                        bMore = true;
+                        IX_LOG( Warning, "Rewound to ts( " << ltPosition.Get() << " )." );
+                        continue;
+
+                    }  // end if
+                    iUncommitted = 0;
+                    iRewinds = 0;
+
+                }  // end if
+
+            }  // end while
+        }
+        catch( const CIXException& ixex )
+        {
+            IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
+            co_return false;
+        }
+        co_return true;
+    }
+
+private:
+    static const int c_iMaxRewinds = 3;  // Maximum number of consecutive rewinds.
+    IIXCallback::SHP m_shpCB;  // Callback interface.
+    CIXAsyncItemsEnumerator m_enumerator;  // Enumerator.
+};
+
+// Runs seeded random queries against an index and checks their results against the items of a
+// deterministic data retrieval, which are retrieved once up front. A query counts only if no
+// commit took place meanwhile, so that the queries may run concurrently with the indexing.
+class CIXQueryChecker : public CLifeReporterAgent< CIXQueryChecker >
+{
+public:
+
+    // Constructor.
+    CIXQueryChecker( IIXQuery::SHP shpQuery, uint64_t uSeed )
+        : m_shpQuery( shpQuery ), m_rng( static_cast< uint32_t >( uSeed ^ ( uSeed >> 32 ) ) | 1 ),
+          m_iChecked( 0 ), m_iMismatches( 0 ), m_bStop( false )
+    {
+        _ASSERTE( m_shpQuery );
+    }
+
+    // Destructor.
+    virtual ~CIXQueryChecker()
+    {
+        // Delegate.
+        Stop();  // void
+    }
+
+    // Retrieves the reference items. Returns false if the retrieval fails.
+    bool Load( IIXDataRetrieval& retrieval )
+    {
+        // Retrieve chunk by chunk.
+        CLogicalTimestamp lt;
+        vector< CIXItem > vecItems;
+        bool bExhausted = false;
+        while( bExhausted == false )
+        {
+            CResult< CLogicalTimestamp > res = retrieval.RetrieveData( lt, 4096, OUT bExhausted, OUT vecItems );
+            if( res.Success() == false )
+                return false;
+            m_vecItems.insert( m_vecItems.end(), vecItems.begin(), vecItems.end() );
+            if( res.AccessRetVal().IsLaterThan( lt ) == false )
+                break;
+            lt = res.AccessRetVal();
+
+        }  // end while
+
+        // Order the items as the queries do and index their values.
+        sort( m_vecItems.begin(), m_vecItems.end(), []( const CIXItem& a, const CIXItem& b ) { return IsBefore( a, b ); } );
+        for( const CIXItem& item : m_vecItems )
+        {
+            int rgiValues[ CIXPreparedData::c_iFields ] = { item.GetI(), item.GetJ(), item.GetK() };
+            for( int iField = 0; iField < CIXPreparedData::c_iFields; iField++ )
+                m_mapPostings[ make_pair( iField, rgiValues[ iField ] ) ].push_back( item.AccessLT().Get() );  // void
+
+        }  // end for
+        return true;
+    }
+
+    // Starts checking in the background until stopped, at most the specified number of queries.
+    void Start( int iQueries )
+    {
+        // Run on a thread of its own.
+        m_thread = thread( [ this, iQueries ]() { Run( iQueries ); } );
+    }
+
+    // Stops checking in the background.
+    void Stop()
+    {
+        // Wait for the query in progress.
+        m_bStop.store( true );
+        if( m_thread.joinable() )
+            m_thread.join();
+        m_bStop.store( false );
+    }
+
+    // Checks the specified number of queries.
+    void Run( int iQueries )
+    {
+        // Nothing to pick from without items.
+        if( m_vecItems.empty() )
+            return;
+        for( int iQuery = 0; iQuery < iQueries && m_bStop.load() == false; )
+        {
+            if( CheckOne() )
+                iQuery++;
+        }
+    }
+
+    // Gets the number of queries checked and the number of them which did not match.
+    int GetChecked() const { return m_iChecked.load(); }
+    int GetMismatches() const { return m_iMismatches.load(); }
+
+private:
+
+    // Determines the order of the items returned by the queries.
+    static bool IsBefore( const CIXItem& a, const CIXItem& b )
+    {
+        return make_tuple( a.AccessLT().Get(), a.GetI(), a.GetJ(), a.GetK() ) < make_tuple( b.AccessLT().Get(), b.GetI(), b.GetJ(), b.GetK() );
+    }
+
+    // Runs and checks a random query. Returns false if a commit took place meanwhile.
+    bool CheckOne()
+    {
+        // Pick a query around a random item.
+        const CIXItem& item = m_vecItems[ Random( m_vecItems.size() ) ];
+        int iFrom = item.AccessLT().Get() - static_cast< int >( Random( 1000 ) );
+        int iTo = item.AccessLT().Get() + static_cast< int >( Random( 1000 ) );
+        int iKind = static_cast< int >( Random( 3 ) );
+        int iField = static_cast< int >( Random( CIXPreparedData::c_iFields ) );
+        int rgiValues[ CIXPreparedData::c_iFields ] = { item.GetI(), item.GetJ(), item.GetK() };
+
+        // Query.
+        CLogicalTimestamp ltCommitted = m_shpQuery->GetCommitted();
+        vector< CLogicalTimestamp > vecTimestamps;
+        vector< CIXItem > vecItems;
+        if( iKind == 0 )
+            m_shpQuery->Lookup( iField, rgiValues[ iField ], CLogicalTimestamp( iFrom ), CLogicalTimestamp( iTo ), OUT vecTimestamps );  // void
+        else if( iKind == 1 )
+            m_shpQuery->ScanRange( CLogicalTimestamp( iFrom ), CLogicalTimestamp( iTo ), OUT vecItems );  // void
+        else
+            m_shpQuery->LookupTimestamp( item.AccessLT(), OUT vecItems );  // void
+        if( m_shpQuery->GetCommitted().Get() != ltCommitted.Get() )
+            return false;
+
+        // Compare with the reference items up to the commit.
+        bool bMatch = false;
+        int iCommitted = ltCommitted.Get();
+        if( iKind == 0 )
+        {
+            vector< int > vecExpected;
+            for( int iTimestamp : m_mapPostings[ make_pair( iField, rgiValues[ iField ] ) ] )
+            {
+                if( iTimestamp >= iFrom && iTimestamp <= std::min( iTo, iCommitted ) &&
+                        ( vecExpected.empty() || vecExpected.back() != iTimestamp ) )
+                    vecExpected.push_back( iTimestamp );  // void
+            }
+            bMatch = vecExpected.size() == vecTimestamps.size() && equal( vecExpected.begin(), vecExpected.end(), vecTimestamps.begin(),
+                    []( int iTimestamp, const CLogicalTimestamp& lt ) { return iTimestamp == lt.Get(); } );
+        }
+        else
+        {
+            if( iKind == 2 )
+                iFrom = iTo = item.AccessLT().Get();
+            vector< CIXItem > vecExpected;
+            vector< CIXItem >::const_iterator itr = lower_bound( m_vecItems.begin(), m_vecItems.end(), iFrom,
+                    []( const CIXItem& itemExpected, int iTimestamp ) { return itemExpected.AccessLT().Get() < iTimestamp; } );
+            for( ; itr != m_vecItems.end() && itr->AccessLT().Get() <= std::min( iTo, iCommitted ); ++itr )
+                vecExpected.push_back( *itr );  // void
+            bMatch = vecExpected.size() == vecItems.size() && equal( vecExpected.begin(), vecExpected.end(), vecItems.begin(),
+                    []( const CIXItem& a, const CIXItem& b ) { return IsBefore( a, b ) == false && IsBefore( b, a ) == false; } );
+
+        }  // end if
+
+        // Count.
+        m_iChecked++;
+        if( bMatch == false )
+        {
+            m_iMismatches++;
+            IX_LOG( Error, "*** Query " << iKind << " from ts( " << iFrom << " ) to ts( " << iTo << " ) at ts( " <<
+                    iCommitted << " ) returned unexpected results." );
+
+        }  // end if
+        return true;
+    }
+
+    // Returns a random number below the specified bound.
+    size_t Random( size_t stBound )
+    {
+        return static_cast< size_t >( m_rng() ) % stBound;
+    }
+
+private:
+    IIXQuery::SHP m_shpQuery;  // Index to query.
+    vector< CIXItem > m_vecItems;  // Reference items in query order.
+    map< pair< int, int >, vector< int > > m_mapPostings;  // Reference timestamps by field and value.
+    std::minstd_rand m_rng;  // Random number generator, seeded for repeatable queries.
+    thread m_thread;  // Background thread.
+    atomic< int > m_iChecked;  // Number of queries checked.
+    atomic< int > m_iMismatches;  // Number of queries with unexpected results.
+    atomic< bool > m_bStop;  // Indicates whether the background checking should stop.
+};
+
+// Options for an indexing request.
+class CIXRequestOptions
+{
+public:
+
+    // Constructor.
+    CIXRequestOptions()
+        : m_bPrefetch( false ), m_iPreparationWorkers( 0 ), m_bAsyncCommit( false ), m_bAdaptive( false ),
+          m_dTargetItemsPerSecond( CIXAdaptiveSizing::c_dDefaultItemsPerSecond ),
+          m_msMaxCommitLag( CIXAdaptiveSizing::c_iDefaultMaxCommitLagMs ),
+          m_stMemoryCeiling( CIXAdaptiveSizing::c_stDefaultMemoryCeiling ),
+          m_bComposed( false ), m_bColumnar( false ), m_bInverted( false ), m_iRequests( 1 ), m_iThreads( 0 ), m_iShards( 0 ), m_bSearchEngine2( false ), m_iAsyncCrawls( 0 ),
+          m_logLevel( CIXLog::Level::Info ), m_msTail( 0 ), m_iQueries( 0 ), m_bBenchmark( false ), m_iBenchmarkItems( 1 << 20 )
+    {
+    }
+
+    // Parses the options from the command line.
+    static CIXRequestOptions Parse( int argc, char* argv[] )
+    {
+        // Check each argument.
+        CIXRequestOptions options;
+        for( int iArg = 1; iArg < argc; iArg++ )
+        {
+            string szArg = argv[ iArg ];
+            if( szArg == "--prefetch" )
+                options.m_bPrefetch = true;
+            else if( szArg == "--journal" && iArg + 1 < argc )
+                options.m_szJournal = argv[ ++iArg ];
+            else if( szArg == "--async-commit" )
+                options.m_bAsyncCommit = true;
+            else if( szArg == "--adaptive" )
+                options.m_bAdaptive = true;
+            else if( szArg == "--target-rate" && iArg + 1 < argc )
+                options.m_dTargetItemsPerSecond = std::max( 1.0, atof( argv[ ++iArg ] ) );
+            else if( szArg == "--max-lag-ms" && iArg + 1 < argc )
+                options.m_msMaxCommitLag = chrono::milliseconds( std::max( 1, atoi( argv[ ++iArg ] ) ) );
+            else if( szArg == "--memory-mb" && iArg + 1 < argc )
+                options.m_stMemoryCeiling = static_cast< size_t >( std::max( 1, atoi( argv[ ++iArg ] ) ) ) << 20;
+            else if( szArg == "--composed" )
+                options.m_bComposed = true;
+            else if( szArg == "--columnar" )
+                options.m_bColumnar = true;
+            else if( szArg == "--inverted" )
+                options.m_bInverted = true;
+            else if( szArg == "--index-dir" && iArg + 1 < argc )
+                options.m_szIndexDirectory = argv[ ++iArg ];
+            else if( szArg == "--requests" && iArg + 1 < argc )
+                options.m_iRequests = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--threads" && iArg + 1 < argc )
+                options.m_iThreads = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--trace" )
+                options.m_logLevel = CIXLog::Level::Trace;
+            else if( szArg == "--log" && iArg + 1 < argc && CIXLog::ParseLevel( argv[ iArg + 1 ], OUT options.m_logLevel ) )
+                iArg++;
+            else if( szArg == "--async-crawls" && iArg + 1 < argc )
+                options.m_iAsyncCrawls = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--engine2" )
+                options.m_bSearchEngine2 = true;
+            else if( szArg == "--shards" && iArg + 1 < argc )
+                options.m_iShards = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--workload" && iArg + 1 < argc )
+                options.m_workload.m_iItems = std::max( 0, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--seed" && iArg + 1 < argc )
+                options.m_workload.m_uSeed = strtoull( argv[ ++iArg ], nullptr, 10 );
+            else if( szArg == "--acceptance" && iArg + 1 < argc )
+                options.m_workload.m_dAcceptance = atof( argv[ ++iArg ] );
+            else if( szArg == "--gaps" && iArg + 1 < argc )
+                options.m_workload.m_dGaps = atof( argv[ ++iArg ] );
+            else if( szArg == "--bursts" && iArg + 1 < argc )
+                options.m_workload.m_dBursts = atof( argv[ ++iArg ] );
+            else if( szArg == "--segment" && iArg + 1 < argc )
+                options.m_workload.m_iSegmentLength = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--chunk-latency-us" && iArg + 1 < argc )
+                options.m_workload.m_usChunkLatency = chrono::microseconds( std::max( 0, atoi( argv[ ++iArg ] ) ) );
+            else if( szArg == "--payload" && iArg + 1 < argc )
+                options.m_workload.m_iPayloadBytes = std::max( 0, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--item-log" && iArg + 1 < argc )
+                options.m_szItemLog = argv[ ++iArg ];
+            else if( szArg == "--write-log" && iArg + 1 < argc )
+                options.m_szWriteLog = argv[ ++iArg ];
+            else if( szArg == "--tail" && iArg + 1 < argc )
+                options.m_msTail = chrono::milliseconds( std::max( 0, atoi( argv[ ++iArg ] ) ) );
+            else if( szArg == "--query" && iArg + 1 < argc )
+                options.m_iQueries = std::max( 0, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--bench" )
+                options.m_bBenchmark = true;
+            else if( szArg == "--bench-items" && iArg + 1 < argc )
+                options.m_iBenchmarkItems = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else if( szArg == "--metrics" && iArg + 1 < argc )
+                options.m_szMetrics = argv[ ++iArg ];
+            else if( szArg == "--prepare" && iArg + 1 < argc )
+                options.m_iPreparationWorkers = std::max( 1, atoi( argv[ ++iArg ] ) );
+            else
+                IX_LOG( Warning, "Ignoring unknown option " << szArg << "." );
+
+        }  // end for
+
+        return options;
+    }
+
+public:
+    bool m_bPrefetch;  // Retrieve the next chunk in the background.
+    int m_iPreparationWorkers;  // Number of preparation workers, or zero to index without preparation.
+    bool m_bAsyncCommit;  // Commit the batches in the background.
+    string m_szJournal;  // Path of the timestamp journal to resume from, if any.
+    bool m_bAdaptive;  // Adapt the chunk and batch sizes to the measured performance.
+    double m_dTargetItemsPerSecond;  // Throughput the adaptive sizing aims for.
+    chrono::milliseconds m_msMaxCommitLag;  // Maximum time between commits with the adaptive sizing.
+    size_t m_stMemoryCeiling;  // Memory available to the chunks with the adaptive sizing.
+    bool m_bComposed;  // Use the statically composed enumerator stack.
+    bool m_bColumnar;  // Hold the chunks column by column.
+    bool m_bInverted;  // Build the in-memory inverted index instead of tracing the items.
+    string m_szIndexDirectory;  // Directory of the inverted index segments, if any.
+    int m_iRequests;  // Number of concurrent indexing requests.
+    int m_iThreads;  // Number of indexer threads, or zero to run a single request on the main thread.
+    int m_iShards;  // Number of timestamp range shards to crawl the available items in parallel, or zero.
+    bool m_bSearchEngine2;  // Use the push based SearchEngine2 job instead of the enumerator stack.
+    int m_iAsyncCrawls;  // Number of crawls to run as coroutines on the event loops, or zero.
+    CIXLog::Level m_logLevel;  // Level of the messages logged. Per-item traces are off by default.
+    string m_szMetrics;  // Path of the file to relay the monitored metrics to, if any.
+    CIXWorkloadSpec m_workload;  // Synthetic workload to retrieve instead of the sample data, if any.
+    string m_szItemLog;  // Path of the item log to retrieve instead of the sample data, if any.
+    string m_szWriteLog;  // Path of the item log to write the retrieved items to instead of indexing, if any.
+    chrono::milliseconds m_msTail;  // Follow the data source until idle for this long, or zero to stop at its end.
+    int m_iQueries;  // Number of queries to check against the inverted index during and after the crawl, or zero.
+    bool m_bBenchmark;  // Run the microbenchmarks instead of indexing.
+    int m_iBenchmarkItems;  // Number of items in each benchmark run.
+};
+
+// Creates the job for an indexing request.
+IIXJob::UP CreateJob( const CIXRequestOptions& options, IIXCallback::SHP shpCB )
+{
+    // SearchEngine2 is pushed the chunks without an enumerator stack.
+    if( options.m_bSearchEngine2 )
+        return CIXJob< CAIXJobSearchEngine2 >::Create( shpCB );
+
+    // The statically composed stack must know the concrete data retrieval. A shard has its range outermost.
+    if( options.m_bComposed && options.m_iShards > 0 )
+        return CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXRangeDataRetrieval > > >::Create( shpCB );
+    if( options.m_bComposed && options.m_bPrefetch )
+        return CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXPrefetchingDataRetrieval > > >::Create( shpCB );
+    if( options.m_bComposed && options.m_szItemLog.empty() == false )
+        return CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXItemLogDataRetrieval > > >::Create( shpCB );
+    if( options.m_bComposed )
+        return options.m_workload.m_iItems > 0
+                ? CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXWorkloadDataRetrieval > > >::Create( shpCB )
+                : CIXJob< CAIXJobComposed< TIXComposedEnumerator< CIXDataRetrieval > > >::Create( shpCB );
+
+    // The virtual stack works with any data retrieval.
+    return CIXJob< CAIXJobSearchEngine1 >::Create( shpCB );
+}
+
+// Creates the data retrieval engine for an indexing request.
+IIXDataRetrieval::SHP CreateDataRetrieval( const CIXRequestOptions& options )
+{
+    // Data retrieval engine.
+    if( options.m_szItemLog.empty() == false )
+    {
+        // The log is read as it is.
+        IIXDataRetrieval::SHP shpDataRetrieval = CIXItemLogDataRetrieval::Create( options.m_szItemLog );
+        if( shpDataRetrieval == nullptr )
+        {
+            IX_LOG( Error, "*** Cannot open the item log " << options.m_szItemLog );
+            return IIXDataRetrieval::SHP();
+
+        }  // end if
+        return options.m_bPrefetch
+                ? shared_ptr< IIXDataRetrieval >( new CIXPrefetchingDataRetrieval( shpDataRetrieval ) )
+                : shpDataRetrieval;
+
+    }  // end if
+    shared_ptr< IIXDataRetrieval > shpDataRetrieval = options.m_workload.m_iItems > 0
+            ? shared_ptr< IIXDataRetrieval >( new CIXWorkloadDataRetrieval( options.m_workload ) )
+            : shared_ptr< IIXDataRetrieval >( new CIXDataRetrieval );
+    if( options.m_bPrefetch )
+        shpDataRetrieval = shared_ptr< IIXDataRetrieval >( new CIXPrefetchingDataRetrieval( shpDataRetrieval ) );
+    return shpDataRetrieval;
+}
+
+// Creates the indexing engine for an indexing request. The suffix tells apart the files of concurrent requests.
+// The inverted index is also returned for querying.
+IIXIndexing::SHP CreateIndexing( const CIXRequestOptions& options, const string& szSuffix, OUT IIXQuery::SHP& shpQuery )
+{
+    // Indexing engine.
+    shared_ptr< IIXIndexing > shpIndexing;
+    shpQuery.reset();  // void
+    if( options.m_szIndexDirectory.empty() == false )
+    {
+        // Persist the inverted index.
+        CIXInvertedIndex::SHP shpIndex = CIXInvertedIndex::Create( options.m_szIndexDirectory + szSuffix );
+        if( shpIndex == nullptr )
+        {
+            IX_LOG( Error, "*** Cannot open the index directory " << options.m_szIndexDirectory + szSuffix );
+            return IIXIndexing::SHP();
+
+        }  // end if
+        shpIndexing = shpIndex;
+        shpQuery = shpIndex;
+    }
+    else if( options.m_bInverted )
+    {
+        CIXInvertedIndex::SHP shpIndex( new CIXInvertedIndex );
+        shpIndexing = shpIndex;
+        shpQuery = shpIndex;
+    }
+    else
+        shpIndexing = shared_ptr< IIXIndexing >( new CIXIndexing );
+    if( options.m_iPreparationWorkers > 0 )
+        shpIndexing = shared_ptr< IIXIndexing >( new CIXPreparationPipeline( shpIndexing,
+                IIXDataPreparation::SHP( new CIXDataPreparation ), options.m_iPreparationWorkers ) );
+    return shpIndexing;
+}
+
+// Opens the timestamp journal of an indexing request, if any, and reads the timestamp to start from.
+// Without a journal, a persisted index resumes from its latest commit.
+bool OpenJournal( const CIXRequestOptions& options, const string& szSuffix, IIXQuery::SHP shpQuery,
+        OUT IIXTimestampManager::SHP& shpTimestampManager, OUT CLogicalTimestamp& lt )
+{
+    // Start from scratch unless resuming from the journal.
+    shpTimestampManager.reset();  // void
+    lt = CLogicalTimestamp();
+    if( options.m_szJournal.empty() == false )
+    {
+        // Read the latest committed timestamp.
+        shpTimestampManager = CIXTimestampManager::Create( options.m_szJournal + szSuffix );
+        if( shpTimestampManager == nullptr )
+        {
+            IX_LOG( Error, "*** Cannot open the journal " << options.m_szJournal + szSuffix );
+            return false;
+
+        }  // end if
+        lt = shpTimestampManager->GetLatestCommitted();
+        IX_LOG( Info, "Resuming from ts( " << lt.Get() << " )." );
+    }
+    else if( shpQuery && options.m_szIndexDirectory.empty() == false )
+    {
+        // Read the timestamp of the latest commit restored from the segments.
+        lt = shpQuery->GetCommitted();
+        IX_LOG( Info, "Resuming from ts( " << lt.Get() << " )." );
+
+    }  // end if
+    return true;
+}
+
+// Creates the adaptive sizing for an indexing request, if requested.
+CIXAdaptiveSizing::SHP CreateSizing( const CIXRequestOptions& options )
+{
+    // Adaptive sizing.
+    return options.m_bAdaptive
+            ? CIXAdaptiveSizing::SHP( new CIXAdaptiveSizing( options.m_dTargetItemsPerSecond, options.m_msMaxCommitLag,
+                    options.m_stMemoryCeiling, CIXAdaptiveSizing::c_iInitialChunkSize, CIXAdaptiveSizing::c_iInitialBatchSize ) )
+            : CIXAdaptiveSizing::SHP();
+}
+
+// Creates the callback for an indexing request. The suffix tells apart the files of concurrent requests.
+IIXCallback::SHP CreateCallback( const CIXRequestOptions& options, const string& szSuffix, IIXMonitor::SHP shpMonitor,
+        OUT IIXQuery::SHP& shpQuery )
+{
+    // Engines.
+    IIXIndexing::SHP shpIndexing = CreateIndexing( options, szSuffix, OUT shpQuery );
+    IIXDataRetrieval::SHP shpDataRetrieval = CreateDataRetrieval( options );
+    if( shpIndexing == nullptr || shpDataRetrieval == nullptr )
+        return IIXCallback::SHP();
+
+    // Overall timestamp.
+    CLogicalTimestamp lt;
+    IIXTimestampManager::SHP shpTimestampManager;
+    if( OpenJournal( options, szSuffix, shpQuery, OUT shpTimestampManager, OUT lt ) == false )
+        return IIXCallback::SHP();
+
+    // Callback.
+    return shared_ptr< IIXCallback >( new CIXCallback( shpDataRetrieval, shpIndexing, lt,
+            options.m_bAsyncCommit, shpTimestampManager, CreateSizing( options ), options.m_bColumnar, shpMonitor ) );
+}
+
+// Creates the query checker for an indexing request, if requested, and starts it in the background.
+unique_ptr< CIXQueryChecker > StartQueryChecker( const CIXRequestOptions& options, IIXQuery::SHP shpQuery )
+{
+    // The reference items must be the same on each retrieval.
+    if( options.m_iQueries == 0 )
+        return unique_ptr< CIXQueryChecker >();
+    if( shpQuery == nullptr || ( options.m_workload.m_iItems == 0 && options.m_szItemLog.empty() ) )
+    {
+        IX_LOG( Error, "*** Checking the queries needs --inverted or --index-dir, and --workload or --item-log." );
+        return unique_ptr< CIXQueryChecker >();
+
+    }  // end if
+
+    // Retrieve the reference items and start.
+    unique_ptr< CIXQueryChecker > upChecker( new CIXQueryChecker( shpQuery, options.m_workload.m_uSeed ) );
+    IIXDataRetrieval::SHP shpDataRetrieval = CreateDataRetrieval( options );
+    if( shpDataRetrieval == nullptr || upChecker->Load( *shpDataRetrieval ) == false )
+    {
+        IX_LOG( Error, "*** Cannot retrieve the reference items of the queries." );
+        return unique_ptr< CIXQueryChecker >();
+
+    }  // end if
+    upChecker->Start( options.m_iQueries );  // void
+    return upChecker;
+}
+
+// Completes the checking of the queries, if any, after the crawl.
+void CompleteQueryChecker( const CIXRequestOptions& options, unique_ptr< CIXQueryChecker >& upChecker )
+{
+    // Check as many again once the index is complete.
+    if( upChecker == nullptr )
+        return;
+    upChecker->Stop();  // void
+    int iDuring = upChecker->GetChecked();
+    upChecker->Run( options.m_iQueries );  // void
+    if( upChecker->GetMismatches() > 0 )
+        IX_LOG( Error, "*** Checked " << upChecker->GetChecked() << " queries, " << iDuring << " of them during the crawl, with " <<
+                upChecker->GetMismatches() << " mismatches." );
+    else
+        IX_LOG( Info, "Checked " << upChecker->GetChecked() << " queries, " << iDuring << " of them during the crawl, with no mismatches." );
+    upChecker.reset();  // void
+}
+
+// Runs an indexing request.
+void RunIndexingRequest( const CIXRequestOptions& options, IIXMonitor::SHP shpMonitor )
+{
+    // Callback.
+    IIXQuery::SHP shpQuery;
+    IIXCallback::SHP shpCB = CreateCallback( options, string(), shpMonitor, OUT shpQuery );
+    if( shpCB == nullptr )
+        return;
+    unique_ptr< CIXQueryChecker > upChecker = StartQueryChecker( options, shpQuery );
+
+    // Error handling.
+    try
+    {
+        // Initialize the job.
+        IX_LOG( Info, "Job being created." );
+        IIXJob::SHP shpJob = IX_UP_TRY( CreateJob( options, shpCB ) );
+
+        // Run the job, following the source if requested.
+        if( options.m_msTail.count() > 0 )
+            shpJob->Follow( options.m_msTail );  // void
+        else
+            shpJob->Run();  // void
+     }
+    catch( CIXException ixex )
+    {
+        IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
+    }
+
+    // Report a failure of the commits still in the background.
+    if( shpCB->Flush() == false )
+        IX_LOG( Error, "*** Commit failed, durable at ts( " << shpCB->GetDurable().Get() << " )." );
+
+    // Check the complete index.
+    CompleteQueryChecker( options, upChecker );  // void
+}
+
+// Runs concurrent indexing requests on the indexer service.
+void RunIndexingRequests( const CIXRequestOptions& options, IIXMonitor::SHP shpMonitor )
+{
+    // Submit the jobs.
+    CIXIndexer indexer( options.m_iThreads > 0 ? options.m_iThreads : static_cast< int >( thread::hardware_concurrency() ) );
+    for( int iRequest = 0; iRequest < options.m_iRequests; iRequest++ )
+    {
+        // Callback.
+        IIXQuery::SHP shpQuery;
+        IIXCallback::SHP shpCB = CreateCallback( options, "." + to_string( iRequest ), shpMonitor, OUT shpQuery );
+        if( shpCB == nullptr )
+            continue;
+
+        // Error handling.
+        try
+        {
+            // Initialize the job.
+            IX_LOG( Info, "Job being created." );
+            indexer.Submit( IX_UP_TRY( CreateJob( options, shpCB ) ) );  // void
+        }
+        catch( const CIXException& ixex )
+        {
+            IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
+        }
+
+    }  // end for
+
+    // Wait for the jobs.
+    indexer.Wait();  // void
+}
+
+// Runs an indexing request as a crawl of the items available now, split into shards by timestamp range.
+void RunShardedCrawl( const CIXRequestOptions& options, IIXMonitor::SHP shpMonitor )
+{
+    // Engines shared by the shards.
+    IIXQuery::SHP shpQuery;
+    IIXIndexing::SHP shpIndexing = CreateIndexing( options, string(), OUT shpQuery );
+    IIXDataRetrieval::SHP shpDataRetrieval = CreateDataRetrieval( options );
+    if( shpIndexing == nullptr || shpDataRetrieval == nullptr )
+        return;
+    CLogicalTimestamp lt;
+    IIXTimestampManager::SHP shpTimestampManager;
+    if( OpenJournal( options, string(), shpQuery, OUT shpTimestampManager, OUT lt ) == false )
+        return;
+
+    // Split the range up to the items available now.
+    CIXShardCoordinator::SHP shpCoordinator( new CIXShardCoordinator( shpIndexing, shpTimestampManager,
+            lt, CLogicalTimestamp( shpDataRetrieval->GetGloballyAvailable() ), options.m_iShards ) );
+
+    // Crawl each shard with its own job.
+    unique_ptr< CIXQueryChecker > upChecker = StartQueryChecker( options, shpQuery );
+    {
+        CIXIndexer indexer( options.m_iThreads > 0 ? options.m_iThreads : static_cast< int >( thread::hardware_concurrency() ) );
+        for( int iShard = 0; iShard < shpCoordinator->GetShardCount(); iShard++ )
+        {
+            // Callback. The first shard uses the retrieval created above.
+            IX_LOG( Info, "Shard " << iShard << " crawling from ts( " << shpCoordinator->AccessShardStart( iShard ).Get() <<
+                    " ) to ts( " << shpCoordinator->AccessShardEnd( iShard ).Get() << " )." );
+            if( iShard > 0 )
+                shpDataRetrieval = CreateDataRetrieval( options );
+            if( shpDataRetrieval == nullptr )
+                continue;
+            IIXCallback::SHP shpCB = shared_ptr< IIXCallback >( new CIXCallback(
+                    shared_ptr< IIXDataRetrieval >( new CIXRangeDataRetrieval( shpDataRetrieval,
+                            shpCoordinator->AccessShardEnd( iShard ) ) ),
+                    shared_ptr< IIXIndexing >( new CIXShardIndexing( shpCoordinator, iShard ) ),
+                    shpCoordinator->AccessShardStart( iShard ), options.m_bAsyncCommit, IIXTimestampManager::SHP(),
+                    CreateSizing( options ), options.m_bColumnar, shpMonitor ) );
+
+            // Error handling.
+            try
+            {
+                // Initialize the job.
+                IX_LOG( Info, "Job being created." );
+                indexer.Submit( IX_UP_TRY( CreateJob( options, shpCB ) ) );  // void
+            }
+            catch( const CIXException& ixex )
+            {
+                IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
+            }
+
+        }  // end for
 
-            // Delegate to the lower layer enumerator.
-            res = m_upLowerLayerEnum->MoveNext( ltLatestSeen );
-            availability = IX_TRY( res );
+        // Wait for the jobs.
+        indexer.Wait();  // void
+    }
 
-            // Check the current availability first.
-            if( availability.AccessAvailability() == CIXAvailability::Available::Perhaps )
-            {
-                // Sanity check.
-                //***if( availability.AccessLatestKnownTimestamp().IsLaterThan( ltLatestSeen ) == false )
-                //***    return CResult< CIXAvailability >( false, res.AccessRetVal() );
+    // Report the progress and check the complete index.
+    IX_LOG( Info, "Crawled " << shpCoordinator->GetShardCount() << " shards up to ts( " <<
+            shpCoordinator->GetLowWatermark().Get() << " )." );
+    CompleteQueryChecker( options, upChecker );  // void
+}
 
-                // Forward the timestamp.
-                m_shpCB->UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+// Runs many crawls as coroutines on a few event loops.
+void RunAsyncCrawls( const CIXRequestOptions& options, IIXMonitor::SHP shpMonitor )
+{
+    // One event loop per thread.
+    vector< unique_ptr< CIXEventLoop > > vecLoops;
+    for( int iLoop = 0; iLoop < std::max( 1, options.m_iThreads ); iLoop++ )
+        vecLoops.push_back( make_unique< CIXEventLoop >() );
+
+    // Spread the crawls over the loops. Each crawl has its own engines.
+    vector< unique_ptr< CIXAsyncJob > > vecJobs;
+    for( int iCrawl = 0; iCrawl < options.m_iAsyncCrawls; iCrawl++ )
+    {
+        // Callback.
+        IIXQuery::SHP shpQuery;
+        IIXCallback::SHP shpCB = CreateCallback( options, "." + to_string( iCrawl ), shpMonitor, OUT shpQuery );
+        if( shpCB == nullptr )
+            continue;
+
+        // Start the job.
+        IX_LOG( Info, "Job being created." );
+        CIXEventLoop& loop = *vecLoops[ iCrawl % vecLoops.size() ];
+        vecJobs.push_back( make_unique< CIXAsyncJob >( shpCB, IIXAsyncDataRetrieval::SHP(
+                new CIXDelayedDataRetrieval( loop, shpCB->AccessDataRetrieval(), chrono::milliseconds( 1 ) ) ) ) );
+        loop.Spawn( vecJobs.back()->Run() );  // void
+
+    }  // end for
+
+    // Run the loops until the crawls are complete.
+    vector< thread > vecThreads;
+    for( unique_ptr< CIXEventLoop >& upLoop : vecLoops )
+        vecThreads.push_back( thread( &CIXEventLoop::Run, upLoop.get() ) );
+    for( thread& t : vecThreads )
+        t.join();
+}
 
-                // Reset the lower layers.
-                Reset( m_shpCB );  // void
+// Writes the items of the data retrieval to the item log, e.g. to turn a synthetic workload into a log.
+void WriteItemLog( const CIXRequestOptions& options )
+{
+    // Engines.
+    IIXDataRetrieval::SHP shpDataRetrieval = CreateDataRetrieval( options );
+    CIXItemLogWriter::SHP shpWriter = CIXItemLogWriter::Create( options.m_szWriteLog );
+    if( shpDataRetrieval == nullptr || shpWriter == nullptr )
+    {
+        IX_LOG( Error, "*** Cannot write the item log " << options.m_szWriteLog );
+        return;
 
-                // Use the updated timestamp.
-                ltLatestSeen = m_shpCB->AccessLatestSeen();
+    }  // end if
 
-                // Indicate that the looping should continue.
-                bContinueWithNewerTimestamp = true;
+    // Copy chunk by chunk, continuing after the items already in the log.
+    CLogicalTimestamp lt = shpWriter->GetLatest();
+    vector< CIXItem > vecItems;
+    bool bExhausted = false;
+    int64_t iWritten = 0;
+    try
+    {
+        while( bExhausted == false )
+        {
+            CLogicalTimestamp ltLatestKnown = IX_TRY( shpDataRetrieval->RetrieveData( lt, 4096, OUT bExhausted, OUT vecItems ) );
+            for( const CIXItem& item : vecItems )
+            {
+                if( shpWriter->Append( item ) == false )
+                    throw CIXException( __LINE__, "Cannot append to the item log" );
+                iWritten++;
 
-            }  // end if
+            }  // end for
+            shpWriter->Notify();  // void
+            if( ltLatestKnown.IsLaterThan( lt ) == false )
+                break;
+            lt = ltLatestKnown;
 
         }  // end while
-
-        return res;
+        if( shpWriter->Flush() == false )
+            throw CIXException( __LINE__, "Cannot flush the item log" );
+    }
+    catch( const CIXException& ixex )
+    {
+        IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
     }
+    IX_LOG( Info, "Wrote " << iWritten << " items to " << options.m_szWriteLog << " up to ts( " << shpWriter->GetLatest().Get() << " )." );
+}
 
-    // Gets the current item.
-    virtual CResult< CIXItem > Current() const override
+// Data retrieval for the benchmarks. Provides the specified number of items without gaps and
+// does nothing else, so that only the enumeration is measured.
+class CIXNullDataRetrieval : public IIXDataRetrieval, public CLifeReporterAgent< CIXNullDataRetrieval >
+{
+public:
+
+    // Constructor.
+    CIXNullDataRetrieval( int iItems )
+        : m_iItems( iItems )
     {
-        // Delegate to the lower layer.
-        return m_upLowerLayerEnum->Current();
     }
 
-    // Resets the enumerator.
-    virtual void Reset( IIXCallback::SHP shpCB ) override
+    // Destructor.
+    virtual ~CIXNullDataRetrieval()
     {
-        // Create the lower enumerator layer.
-        cout << "Batch being initialized." << endl;
-        m_upLowerLayerEnum = IX_UP_TRY( CIXItemsBatched::Create( shpCB ) );
     }
 
-private:
+// IIXDataRetrieval
+public:
 
-    // Delete the default constructor.
-    CIXItemsEnumerator() = delete;
+    // Returns the number of items globally available.
+    virtual int GetGloballyAvailable() override
+    {
+        return m_iItems;
+    }
 
-    // Constructor.
-    CIXItemsEnumerator( IIXCallback::SHP shpCB ) :
-        m_shpCB( shpCB )
+    // Retrieves data.
+    virtual CResult< CLogicalTimestamp > RetrieveData(
+        const CLogicalTimestamp& ltLatestSeen,
+        int iCount,
+        OUT bool& bExhausted,
+        OUT vector< CIXItem >& vecItems
+    ) override
     {
-        // Delegate.
-        Reset( m_shpCB );  // void
+        // Fill the rows up to the end.
+        vecItems.clear();
+        int iStart = ltLatestSeen.Get() + 1;
+        int iEnd = std::min( iStart + iCount, m_iItems + 1 );
+        for( int iItem = iStart; iItem < iEnd; iItem++ )
+            vecItems.push_back( CIXItem( iItem * 2, iItem * 3, iItem * 4, CLogicalTimestamp( iItem ) ) );
+        bExhausted = iEnd > m_iItems;
+        return CResult< CLogicalTimestamp >( true, CLogicalTimestamp( std::max( iStart - 1, iEnd - 1 ) ) );
     }
 
 private:
-    IIXCallback::SHP m_shpCB;  // Callback interface.
-    IIXEnumerable::UP m_upLowerLayerEnum;  // The lower layer enumerator.
+    int m_iItems;  // Number of items.
 };
 
-// Indexer job interface.
-class IIXJob
+// Indexing engine for the benchmarks. Accepts everything without doing anything.
+class CIXNullIndexing : public IIXIndexing, public CLifeReporterAgent< CIXNullIndexing >
 {
 public:
 
-    // Helper types.
-    typedef shared_ptr< IIXJob > SHP;
+    // Destructor.
+    virtual ~CIXNullIndexing()
+    {
+    }
 
-    // Helper types.
-    typedef unique_ptr< IIXJob > UP;
+// IIXIndexing
+public:
 
-    // Runs the job.
-    virtual void Run() = 0;
+    // Indexes data.
+    virtual bool Index( const CIXItem& ) override { return true; }
 
-    // Destructor.
-    virtual ~IIXJob()
+    // Indexes a batch of data.
+    virtual bool IndexBatch( span< const CIXItem > ) override { return true; }
+
+    // Indexes a batch of data stored column by column.
+    virtual bool IndexColumns( const CIXItemColumnsView& ) override { return true; }
+
+    // Commits the current state.
+    virtual bool Commit( const CLogicalTimestamp&, int ) override { return true; }
+};
+
+// Callback with fixed chunk and batch sizes, for sweeping the sizes in the benchmarks.
+class CIXFixedSizeCallback : public CIXCallback
+{
+public:
+
+    // Constructor.
+    CIXFixedSizeCallback( IIXDataRetrieval::SHP shpDataRetrieval, IIXIndexing::SHP shpIndexing, int iChunkSize, int iBatchSize )
+        : CIXCallback( shpDataRetrieval, shpIndexing, CLogicalTimestamp() ), m_iChunkSize( iChunkSize ), m_iBatchSize( iBatchSize )
     {
     }
+
+// IIXCallback
+public:
+
+    // Returns the batch size.
+    virtual int GetBatchSize() override { return m_iBatchSize; }
+
+    // Returns the chunk size.
+    virtual int GetChunkSize() override { return m_iChunkSize; }
+
+private:
+    int m_iChunkSize;  // Chunk size.
+    int m_iBatchSize;  // Batch size.
 };
 
-// Helper aspect interface
-class IAIXJob
+// Object tracked by the life reporter, for measuring the tracking.
+class CIXTrackedProbe : public CLifeReporterAgent< CIXTrackedProbe >
 {
 public:
-    
-    // Resets the aspect.
-    virtual void Reset( IIXCallback::SHP shpCB ) = 0;
-
-    // Runs the job.
-    virtual void RunImpl() = 0;
+    int m_i = 0;  // Payload.
+};
 
-    // Processes the specified item.
-    virtual CResult< bool > Process( const CIXItem& item ) = 0;
+// Object without tracking, as the baseline of the above.
+class CIXUntrackedProbe
+{
+public:
 
     // Destructor.
-    virtual ~IAIXJob()
+    virtual ~CIXUntrackedProbe()
     {
     }
-};
 
+public:
+    int m_i = 0;  // Payload.
+};
 
-// Base class for helper aspect classes for combined indexer jobs.
-class CAIXJobBase : public IAIXJob
+// Microbenchmarks of the enumerator layers and the indexing interfaces. Each case runs over the
+// no-op retrieval and indexing engine, is repeated a few times, and reports the fastest run as
+// nanoseconds and heap allocations per item. The cases without items count one operation as an item.
+class CIXBenchmark : public CLifeReporterAgent< CIXBenchmark >
 {
 public:
 
-    // Destructor.
-    virtual ~CAIXJobBase()
+    // Constructor.
+    CIXBenchmark( int iItems )
+        : m_iItems( std::max( 1, iItems ) )
     {
     }
 
-    // Resets the aspect.
-    virtual void Reset( IIXCallback::SHP shpCB ) override
+    // Runs all cases.
+    void Run()
     {
-        // Set the member.
-        m_shpCB = shpCB;
+        // The chunk layer alone, item by item.
+        for( int iChunkSize : c_rgiChunkSizes )
+            Measure( "chunked", iChunkSize, 0, [ & ]() { return Drain< CIXItemsChunked >( iChunkSize, m_iItems ); } );  // void
 
-        // Create the lower enumerator layer.
-        cout << "Enumerator being initialized." << endl;
-        m_upLowerLayerEnum = IX_UP_TRY( CIXItemsEnumerator::Create( shpCB ) );
-    }
+        // The batch boundaries, and the full stack with its resets at the boundaries.
+        for( int iChunkSize : c_rgiChunkSizes )
+        {
+            for( int iBatchSize : c_rgiBatchSizes )
+            {
+                Measure( "batched", iChunkSize, iBatchSize, [ & ]() { return Drain< CIXItemsBatched >( iChunkSize, iBatchSize ); } );  // void
+                Measure( "enumerator", iChunkSize, iBatchSize, [ & ]() { return Drain< CIXItemsEnumerator >( iChunkSize, iBatchSize ); } );  // void
+                Measure( "item_range", iChunkSize, iBatchSize, [ & ]() { return Iterate( iChunkSize, iBatchSize ); } );  // void
+                Measure( "item_range_composed", iChunkSize, iBatchSize, [ & ]() { return IterateComposed( iChunkSize, iBatchSize ); } );  // void
+                Measure( "job_run", iChunkSize, iBatchSize, [ & ]() { return RunJob( iChunkSize, iBatchSize ); } );  // void
 
-protected:
-    IIXEnumerable::UP m_upLowerLayerEnum;  // The lower layer enumerator.
-    IIXCallback::SHP m_shpCB;  // Callback interface.
-};
+            }  // end for
 
-// Helper aspect class for SearchEngine1 indexer jobs.
-class CAIXJobSearchEngine1 : public CAIXJobBase
-{
-public:
+        }  // end for
 
-    // Destructor.
-    virtual ~CAIXJobSearchEngine1()
-    {
+        // Resetting the full stack.
+        Measure( "enumerator_reset", 0, 0, [ & ]() { return ResetEnumerator(); } );  // void
+
+        // Processing by the job, item by item.
+        Measure( "job_process", 0, 0, [ & ]() { return ProcessItems(); } );  // void
+
+        // The lifecycle tracking of an object, and the same without it.
+        Measure( "life_reporter", 0, 0, [ & ]() { return Construct< CIXTrackedProbe >(); } );  // void
+        Measure( "life_reporter_baseline", 0, 0, [ & ]() { return Construct< CIXUntrackedProbe >(); } );  // void
     }
 
-    // Runs the job.
-    virtual void RunImpl() override
+    // Writes the results as JSON.
+    void WriteJson( ostream& os ) const
     {
-        // Proceed with the enumerator.
-        while( IX_TRY( m_upLowerLayerEnum->MoveNext( m_shpCB->AccessLatestSeen() ) ).AccessAvailability() != CIXAvailability::Available::No )
+        os << "{\n  \"items\": " << m_iItems << ",\n  \"allocation_counting\": " <<
+                ( CIXAllocationCounter::IsEnabled() ? "true" : "false" ) << ",\n  \"results\": [";
+        for( size_t stResult = 0; stResult < m_vecResults.size(); stResult++ )
         {
-            // Get the current item.
-            const CIXItem& item = IX_TRY( m_upLowerLayerEnum->Current() );
+            const Result& result = m_vecResults[ stResult ];
+            os << ( stResult == 0 ? "\n" : ",\n" ) << "    { \"name\": \"" << result.m_pszName << "\", " <<
+                    "\"chunk_size\": " << FormatSize( result.m_iChunkSize ) << ", " <<
+                    "\"batch_size\": " << FormatSize( result.m_iBatchSize ) << ", " <<
+                    "\"ns_per_item\": " << result.m_dNanosPerItem << ", " <<
+                    "\"allocs_per_item\": " << FormatAllocations( result.m_dAllocationsPerItem ) << " }";
 
-            // Process the current item.
-            IX_TRY( this->Process( item ) );  // Return value ignored.
-        }
+        }  // end for
+        os << "\n  ]\n}\n";
     }
-};
 
-// Helper aspect class for SearchEngine2 indexer jobs.
-class CAIXJobSearchEngine2 : public CAIXJobBase
-{
-public:
+private:
 
-    // Destructor.
-    virtual ~CAIXJobSearchEngine2()
+    // Result of a case.
+    struct Result
+    {
+        const char* m_pszName;  // Name of the case.
+        int m_iChunkSize;  // Chunk size, or zero if not applicable.
+        int m_iBatchSize;  // Batch size, or zero if not applicable.
+        double m_dNanosPerItem;  // Nanoseconds per item.
+        double m_dAllocationsPerItem;  // Heap allocations per item.
+    };
+
+    // Runs a case repeatedly and records the fastest run. The body returns the number of items.
+    template< typename TBody >
+    void Measure( const char* pszName, int iChunkSize, int iBatchSize, TBody body )
     {
+        // Repeat.
+        Result result = { pszName, iChunkSize, iBatchSize, numeric_limits< double >::max(), 0.0 };
+        for( int iRepetition = 0; iRepetition < c_iRepetitions; iRepetition++ )
+        {
+            uint64_t uAllocations = CIXAllocationCounter::Get();
+            chrono::steady_clock::time_point tpStart = chrono::steady_clock::now();
+            int64_t iItems = std::max< int64_t >( 1, body() );
+            chrono::nanoseconds nsElapsed = chrono::steady_clock::now() - tpStart;
+            double dNanosPerItem = static_cast< double >( nsElapsed.count() ) / static_cast< double >( iItems );
+            if( dNanosPerItem < result.m_dNanosPerItem )
+            {
+                result.m_dNanosPerItem = dNanosPerItem;
+                result.m_dAllocationsPerItem =
+                        static_cast< double >( CIXAllocationCounter::Get() - uAllocations ) / static_cast< double >( iItems );
+
+            }  // end if
+
+        }  // end for
+        m_vecResults.push_back( result );  // void
     }
 
-    // Runs the job.
-    virtual void RunImpl() override
+    // Creates a callback over the no-op engines.
+    IIXCallback::SHP CreateCallback( int iChunkSize, int iBatchSize ) const
     {
+        // Callback.
+        return IIXCallback::SHP( new CIXFixedSizeCallback( IIXDataRetrieval::SHP( new CIXNullDataRetrieval( m_iItems ) ),
+                IIXIndexing::SHP( new CIXNullIndexing ), iChunkSize, iBatchSize ) );
     }
-};
-
-// Indexer job based on a templated aspect.
-template< typename TAIXJob >
-class CIXJob : public IIXJob, public TAIXJob, public CLifeReporterAgent< CIXJob< TAIXJob > >
-{
-public:
 
-    // Factory method.
-    static IIXJob::UP Create( IIXCallback::SHP shpCB )
+    // Enumerates all items item by item with the specified enumerator. A layer below the top one
+    // returns Perhaps at its boundaries, and is then started anew as the layer above it would.
+    template< typename TEnumerable >
+    int64_t Drain( int iChunkSize, int iBatchSize )
     {
-        // Sanity check.
-        if( shpCB == nullptr )
-            return IIXJob::UP();
+        // Enumerate.
+        IIXCallback::SHP shpCB = CreateCallback( iChunkSize, iBatchSize );
+        IIXEnumerable::UP upEnum = IX_UP_TRY( TEnumerable::Create( shpCB ) );
+        int64_t iItems = 0;
+        int64_t iChecksum = 0;
+        while( true )
+        {
+            CIXAvailability availability = IX_TRY( upEnum->MoveNext( shpCB->AccessLatestSeen() ) );
+            if( availability.AccessAvailability() == CIXAvailability::Available::No )
+                break;
+            if( availability.AccessAvailability() == CIXAvailability::Available::Perhaps )
+            {
+                shpCB->UpdateIfLater( availability.AccessLatestKnownTimestamp() );  // void
+                upEnum->Start( shpCB );  // void
+                continue;
 
-        // Delegate.
-        return IIXJob::UP( static_cast< IIXJob* >( new CIXJob( shpCB ) ) );
+            }  // end if
+            iChecksum += IX_TRY( upEnum->Current() ).GetI();
+            iItems++;
+
+        }  // end while
+
+        // All items must have been seen.
+        if( iChecksum != static_cast< int64_t >( m_iItems ) * ( m_iItems + 1 ) )
+            throw CIXException( __LINE__, "Benchmark enumerated unexpected items" );
+        return iItems;
     }
 
-    // Destructor.
-    virtual ~CIXJob()
+    // Iterates over all items with the item range over the full stack.
+    int64_t Iterate( int iChunkSize, int iBatchSize )
     {
+        // Iterate.
+        IIXCallback::SHP shpCB = CreateCallback( iChunkSize, iBatchSize );
+        IIXEnumerable::UP upEnum = IX_UP_TRY( CIXItemsEnumerator::Create( shpCB ) );
+        return Checksum( CIXItemRange( *upEnum, shpCB ) );
     }
 
-// IIXJob
-public:
-
-    // Runs the job.
-    virtual void Run() override
+    // Iterates over all items with the item range over the statically composed stack.
+    int64_t IterateComposed( int iChunkSize, int iBatchSize )
     {
-        // Delegate.
-        TAIXJob::RunImpl();  // void
+        // Iterate.
+        IIXCallback::SHP shpCB = CreateCallback( iChunkSize, iBatchSize );
+        TIXComposedEnumerator< CIXNullDataRetrieval > enumerator;
+        enumerator.Start( shpCB );  // void
+        return Checksum( TIXItemRange< TIXComposedEnumerator< CIXNullDataRetrieval > >( enumerator, shpCB ) );
     }
 
-// AIXJob
-public:
+    // Verifies the items of the specified range. Returns their number.
+    template< typename TRange >
+    int64_t Checksum( TRange&& range ) const
+    {
+        // Visit.
+        int64_t iItems = 0;
+        int64_t iChecksum = 0;
+        for( const CIXItem& item : range )
+        {
+            iChecksum += item.GetI();
+            iItems++;
 
-    // Processes the specified item.
-    virtual CResult< bool > Process( const CIXItem& item ) override
+        }  // end for
+
+        // All items must have been seen.
+        if( iChecksum != static_cast< int64_t >( m_iItems ) * ( m_iItems + 1 ) )
+            throw CIXException( __LINE__, "Benchmark iterated unexpected items" );
+        return iItems;
+    }
+
+    // Runs a SearchEngine1 job over all items.
+    int64_t RunJob( int iChunkSize, int iBatchSize )
     {
-        // Try to index.
-        _ASSERTE( m_shpCB );
-        bool bSuccess = false;
-        IIXIndexing::SHP shpIndexing = m_shpCB->AccessIndexing();
-        if( shpIndexing )
-            bSuccess = shpIndexing->Index( item );
+        // Run.
+        IIXCallback::SHP shpCB = CreateCallback( iChunkSize, iBatchSize );
+        IIXJob::UP upJob = IX_UP_TRY( CIXJob< CAIXJobSearchEngine1 >::Create( shpCB ) );
+        upJob->Run();  // void
+        return m_iItems;
+    }
 
-        // Update the status.
-        m_shpCB->UpdateIfLater( item.AccessLT() );  // void
+    // Resets the full enumerator stack repeatedly.
+    int64_t ResetEnumerator()
+    {
+        // Reset.
+        IIXCallback::SHP shpCB = CreateCallback( 10, 100 );
+        IIXEnumerable::UP upEnum = IX_UP_TRY( CIXItemsEnumerator::Create( shpCB ) );
+        for( int iReset = 0; iReset < m_iItems; iReset++ )
+            upEnum->Start( shpCB );  // void
+        return m_iItems;
+    }
 
-        // Return the success status.
-        return CResult< bool >( true, bSuccess );
+    // Processes the items one by one with a SearchEngine1 job.
+    int64_t ProcessItems()
+    {
+        // Process.
+        IIXCallback::SHP shpCB = CreateCallback( 10, 100 );
+        IIXJob::UP upJob = IX_UP_TRY( CIXJob< CAIXJobSearchEngine1 >::Create( shpCB ) );
+        IAIXJob& job = dynamic_cast< IAIXJob& >( *upJob );
+        for( int iItem = 1; iItem <= m_iItems; iItem++ )
+            IX_TRY( job.Process( CIXItem( iItem * 2, iItem * 3, iItem * 4, CLogicalTimestamp( iItem ) ) ) );  // Return value ignored.
+        return m_iItems;
     }
 
-private:
+    // Constructs and destroys objects of the specified class repeatedly.
+    template< typename TProbe >
+    int64_t Construct()
+    {
+        // The address escapes so that the construction is not optimized away.
+        for( int iObject = 0; iObject < m_iItems; iObject++ )
+        {
+            TProbe probe;
+            s_pvSink = &probe;
 
-    // Delete the default constructor.
-    CIXJob() = delete;
+        }  // end for
+        return m_iItems;
+    }
 
-    // Constructor.
-    CIXJob( IIXCallback::SHP shpCB ) :
-        m_shpCB( shpCB )
+    // Formats a size, which is null if not applicable.
+    static string FormatSize( int iSize )
     {
-        // Delegate.
-        Reset( m_shpCB );  // void
+        return iSize > 0 ? to_string( iSize ) : string( "null" );
     }
 
-    // Resets the enumerator.
-    void Reset( IIXCallback::SHP shpCB )
+    // Formats the allocations per item, which are null unless the allocations are counted.
+    static string FormatAllocations( double dAllocationsPerItem )
     {
-        // Delegate to the aspect.
-        TAIXJob::Reset( shpCB );
+        if( CIXAllocationCounter::IsEnabled() == false )
+            return string( "null" );
+        ostringstream oss;
+        oss << dAllocationsPerItem;
+        return oss.str();
     }
 
 private:
-    IIXCallback::SHP m_shpCB;  // Callback interface.
+    static constexpr int c_rgiChunkSizes[] = { 1, 10, 100, 1000 };  // Swept chunk sizes.
+    static constexpr int c_rgiBatchSizes[] = { 10, 100, 1000 };  // Swept batch sizes.
+    static const int c_iRepetitions = 3;  // Runs of each case.
+    static void* volatile s_pvSink;  // Destination of the escaping addresses.
+    int m_iItems;  // Number of items in each run.
+    vector< Result > m_vecResults;  // Results.
 };
 
-// Runs an indexing request.
-void RunIndexingRequest()
-{
-    // Data retrieval engine.
-    shared_ptr< IIXDataRetrieval > shpDataRetrieval = shared_ptr< IIXDataRetrieval >( new CIXDataRetrieval );
-
-    // Indexing engine.
-    shared_ptr< IIXIndexing > shpIndexing = shared_ptr< IIXIndexing >( new CIXIndexing );
-
-    // Overall timestamp. Start from scratch.
-    CLogicalTimestamp lt;
-
-    // Callback.
-    shared_ptr< IIXCallback > shpCB = shared_ptr< IIXCallback >( new CIXCallback( shpDataRetrieval, shpIndexing, lt ) );
+// Initialization of static members.
+void* volatile CIXBenchmark::s_pvSink = nullptr;
 
-    // Error handling.
+// Runs the microbenchmarks and writes the results as JSON to the standard output.
+void RunBenchmarks( const CIXRequestOptions& options )
+{
+    // Only errors are logged, so that the output stays machine-readable.
+    CIXLog::SetLevel( CIXLog::Level::Error );  // void
     try
     {
-        // Initialize the job.
-        cout << "Job being created." << endl;
-        typedef CIXJob< CAIXJobSearchEngine1 > CIXJOB;
-        CIXJOB::SHP shpJob = IX_UP_TRY( CIXJOB::Create( shpCB ) );
-
-        // Run the job.
-        shpJob->Run();  // void
-     }
-    catch( CIXException ixex )
+        // Run.
+        CIXBenchmark benchmark( options.m_iBenchmarkItems );
+        benchmark.Run();  // void
+        CIXLog::Flush();  // void
+        benchmark.WriteJson( cout );  // void
+    }
+    catch( const CIXException& ixex )
     {
-        cout << "*** CIXException on line " << ixex.where() << endl;
-        cout << ixex.what();
+        IX_LOG( Error, "*** CIXException on line " << ixex.where() << endl << ixex.what() );
     }
 }
 
 // Main program.
-int main()
+int main( int argc, char* argv[] )
 {
-    // Run an indexing request.
-    RunIndexingRequest();  // void
+    // Run the indexing requests.
+    CIXRequestOptions options = CIXRequestOptions::Parse( argc, argv );
+    CIXLog::SetLevel( options.m_logLevel );  // void
+    if( options.m_bBenchmark )
+    {
+        RunBenchmarks( options );  // void
+        return 0;
+
+    }  // end if
+    CIXMonitorRelay::SHP shpMonitor;
+    if( options.m_szMetrics.empty() == false )
+        shpMonitor.reset( new CIXMonitorRelay( options.m_szMetrics ) );  // void
+    if( options.m_szWriteLog.empty() == false )
+        WriteItemLog( options );  // void
+    else if( options.m_iAsyncCrawls > 0 )
+        RunAsyncCrawls( options, shpMonitor );  // void
+    else if( options.m_iShards > 0 )
+        RunShardedCrawl( options, shpMonitor );  // void
+    else if( options.m_iRequests > 1 || options.m_iThreads > 0 )
+        RunIndexingRequests( options, shpMonitor );  // void
+    else
+        RunIndexingRequest( options, shpMonitor );  // void
+
+    // Relay the final metrics.
+    if( shpMonitor )
+    {
+        if( shpMonitor->Export() == false )
+            IX_LOG( Error, "*** Cannot write the metrics to " << options.m_szMetrics );
+        shpMonitor->LogSummary();  // void
+        shpMonitor.reset();  // void
+
+    }  // end if
 
     // Report object lifes.
     CLifeReporter::Report();  // void